@@ -40,14 +40,13 @@ public:
     // ...
   }
   inline void gps_time(ShellBuffer& B) {
-    B.printf("%02d/%02d/20%02d,%02d.%02d,%02d.%04u,",
-      (int) m_gps.day,
-      (int) m_gps.month,
-      (int) m_gps.year,
-      (int) m_gps.hour,
-      (int) m_gps.minute,
-      (int) m_gps.seconds,
-      (unsigned int) m_gps.milliseconds);
+    B << width(2, '0') << (int) m_gps.day << '/'
+      << width(2, '0') << (int) m_gps.month << "/20"
+      << width(2, '0') << (int) m_gps.year << ','
+      << width(2, '0') << (int) m_gps.hour << '.'
+      << width(2, '0') << (int) m_gps.minute << ','
+      << width(2, '0') << (int) m_gps.seconds << '.'
+      << width(4, '0') << (unsigned int) m_gps.milliseconds << ',';
   }
   inline void gps_latitude(ShellBuffer& B) {
     float coord = abs(m_gps.latitudeDegrees);
@@ -56,7 +55,8 @@ public:
     int minutes = (int) coord;
     coord = (coord - (float) minutes) * 60;
 
-    B.printf("%3d^%02d'%.4f\"%c,", degrees, minutes, coord, m_gps.lat ? m_gps.lat : ((m_gps.latitudeDegrees < 0) ? 'S' : 'N'));
+    B << width(3) << degrees << '^' << width(2, '0') << minutes << '\'' << precision(4) << coord << '"'
+      << (m_gps.lat ? m_gps.lat : ((m_gps.latitudeDegrees < 0) ? 'S' : 'N')) << ',';
   }
   inline void gps_longitude(ShellBuffer& B) {
     float coord = abs(m_gps.longitudeDegrees);
@@ -65,10 +65,11 @@ public:
     int minutes = (int) coord;
     coord = (coord - (float) minutes) * 60;
 
-    B.printf("%3d^%02d'%.4f\"%c,", degrees, minutes, coord, m_gps.lon ? m_gps.lon : ((m_gps.longitudeDegrees < 0) ? 'W' : 'E'));
+    B << width(3) << degrees << '^' << width(2, '0') << minutes << '\'' << precision(4) << coord << '"'
+      << (m_gps.lon ? m_gps.lon : ((m_gps.longitudeDegrees < 0) ? 'W' : 'E')) << ',';
   }
   inline void gps_lat_lon(ShellBuffer& B) {
-    B.printf("%.6f,%.6f,", m_gps.latitudeDegrees, m_gps.longitudeDegrees);
+    B << precision(6) << m_gps.latitudeDegrees << ',' << m_gps.longitudeDegrees << ',';
   }
   void summary(ShellBuffer& B) {
     gps_time(B);
@@ -118,18 +119,16 @@ public:
     }
 
     gps_time(*B);
-    origin << *B;
 
     if (!m_gps.fix) {
-      origin << " (no fix)" << 0;
+      *B << " (no fix)";
     } else {
-      B->clear();
       gps_latitude(*B);
       gps_longitude(*B);
       gps_lat_lon(*B);
-      origin << *B << 0;
     }
-    B->return_to_owner();
+    origin.dispatch_owned(B);
+    origin << 0;
   }
 
   bool update() {
@@ -194,6 +193,13 @@ public:
     }
     return afr == 0;
   }
+  virtual void discard() { // returns the buffer, so that the GPS isn't left busy
+    if (m_buf) {
+      m_buf->return_to_owner();
+      m_buf = 0;
+      m_ptr = 0;
+    }
+  }
 };
 
 /* Define globally
@@ -219,8 +225,8 @@ class App : public Timer, public ShellHandler {
 private:
   CommandList  m_list;
 
-  Shell  m_one;
-  Shell  m_two;
+  SizedShell<> m_one;
+  SizedShell<> m_two;
   Shell *m_last;
 
   bool  m_bDemo;
@@ -297,12 +303,14 @@ public:
     if (m_bDemo) {
       Serial3.println(analogRead(A0));
     }
-    if (false /*m_gps->update()*/) {
+    if (false /*m_gps->update()*/ && m_one.available(rp_Broadcast) >= 2) { // otherwise skip rather than drop the summary
       ShellBuffer *B = Shell::tmp_buffer();
       if (B) {
         m_gps->summary(*B);
-        m_one << *B << 0;
-        B->return_to_owner();
+        *B << '\n';
+
+        Dispatcher *shells[] = { &m_one, &m_two };
+        Dispatcher::broadcast(shells, 2, B);
       }
     } else {
       //
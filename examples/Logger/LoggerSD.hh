@@ -58,6 +58,13 @@ public:
     return ic;
   }
   inline bool done() const { return m_bDone && m_in.is_empty(); }
+  inline void close() { // abandon the rest of the file
+    if (!m_bDone) {
+      m_file.close();
+      m_bDone = true;
+    }
+    m_in.clear();
+  }
 
   virtual void sync_read();
   virtual void sync_write();
@@ -115,6 +122,9 @@ public:
     }
     return m_file.done();
   }
+  virtual void discard() { // closes the file
+    m_file.close();
+  }
 };
 
 class LoggerSD {
@@ -0,0 +1,1883 @@
+/* -*- mode: c++ -*-
+ * 
+ * Copyright 2022 Francis James Franklin
+ * 
+ * Open Source under the MIT License - see LICENSE in the project's root folder
+ */
+
+#include <Shell.hh>
+#include <ShellExtra.hh>
+
+#include <new>
+#include <time.h>
+
+using namespace MultiShell;
+
+static double s_seconds() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double) ts.tv_sec + 1E-9 * (double) ts.tv_nsec;
+}
+
+/* Results are written to stdout as JSON, e.g., {"suite": ..., "results": [{"name": ..., "value": ..., "unit": ...}, ...]};
+ * consistency errors go to stderr, and make the benchmark exit with status 1
+ */
+static int s_result_count = 0;
+static int s_error_count = 0;
+
+static void s_result(const char *name, double value, const char *unit) {
+  printf("%s\n    { \"name\": \"%s\", \"value\": %.6g, \"unit\": \"%s\" }", s_result_count++ ? "," : "", name, value, unit);
+}
+
+static void s_error(const char *message) {
+  fprintf(stderr, "benchmark: error! %s\n", message);
+  ++s_error_count;
+}
+
+/* CommaComms input: a mix of short and long values, bare commands, and some rejected input; the first ten
+ * samples are plain unsigned commands, the only kind the original parser understood
+ */
+static int s_comma_input(char *buffer, int length, bool bUnsignedOnly = false) {
+  static const char *sample[] = {
+    "a123,", "B4567890,", "x,", "f127,", "P1234567890,", "R2,", "q12345678901,", "!7,", "v42,", "c0,",
+    "s-250,", "I.1069547520,", "m--1,", "v12:34:-56:.1069547520,"
+  };
+  const int sample_count = bUnsignedOnly ? 10 : sizeof(sample) / sizeof(const char *);
+
+  int count = 0;
+  for (int i = 0; ; i = (i + 1) % sample_count) {
+    int sublen = strlen(sample[i]);
+    if (count + sublen > length)
+      break;
+    memcpy(buffer + count, sample[i], sublen);
+    count += sublen;
+  }
+  return count;
+}
+
+class CommaTally : public Comma::Sink {
+public:
+  unsigned long  m_count;
+  unsigned long  m_sum;
+
+  CommaTally() : m_count(0), m_sum(0) {
+    // ...
+  }
+  virtual ~CommaTally() {
+    // ...
+  }
+  virtual void comma_received(CommaCommand& command) {
+    ++m_count;
+    m_sum += command.m_command + command.m_type + command.m_value;
+  }
+  virtual void comma_vector_received(CommaVector& vector) {
+    ++m_count;
+    for (int i = 0; i < vector.count(); i++)
+      m_sum += vector.m_command + vector[i].m_type + vector[i].m_value;
+  }
+};
+
+/* The original Comma::push(), one character at a time with sscanf(), kept as a reference for the decoder
+ */
+class ReferenceComma {
+private:
+  int  m_length;
+  char m_buffer[16];
+public:
+  ReferenceComma() : m_length(0) {
+    // ...
+  }
+
+  bool push(char next, CommaCommand& command) {
+    command.m_command = 0;
+    command.m_value = 0;
+
+    if ((next >= 'A' && next <= 'Z') || (next >= 'a' && next <= 'z')) {
+      m_buffer[0] = next;
+      m_length = 1;
+    } else if (next >= '0' && next <= '9') {
+      if (m_length > 0 && m_length < 11) {
+	m_buffer[m_length++] = next;
+      } else {
+	m_length = 0;
+      }
+    } else if (m_length && next == ',') {
+      command.m_command = m_buffer[0];
+      if (m_length > 1) {
+	m_buffer[m_length] = 0;
+	if (sscanf(m_buffer + 1, "%lu", &command.m_value) != 1)
+	  command.m_command = 0;
+      }
+      m_length = 0;
+    } else {
+      m_length = 0;
+    }
+    return (command.m_command != 0);
+  }
+};
+
+static void bench_comma_push() {
+  static char input[4096];
+  int length = s_comma_input(input, sizeof(input));
+
+  const int passes = 2000;
+
+  Comma C;
+  CommaTally by_char;
+
+  double t0 = s_seconds();
+  for (int p = 0; p < passes; p++)
+    for (int i = 0; i < length; i++)
+      C.push(input[i], by_char);
+  double t_char = s_seconds() - t0;
+
+  Comma B;
+  CommaTally by_block;
+
+  t0 = s_seconds();
+  for (int p = 0; p < passes; p++)
+    B.push_block(input, length, by_block);
+  double t_block = s_seconds() - t0;
+
+  s_result("comma.push", by_char.m_count / t_char, "commands/s");
+  s_result("comma.push_block", by_block.m_count / t_block, "commands/s");
+
+  if (by_char.m_count != by_block.m_count || by_char.m_sum != by_block.m_sum)
+    s_error("comma: push and push_block disagree");
+
+  /* against the original parser, on the input it understood
+   */
+  static char plain[4096];
+  int plain_length = s_comma_input(plain, sizeof(plain), true);
+
+  ReferenceComma O;
+  CommaTally by_reference;
+  CommaCommand command;
+
+  t0 = s_seconds();
+  for (int p = 0; p < passes; p++)
+    for (int i = 0; i < plain_length; i++)
+      if (O.push(plain[i], command))
+	by_reference.comma_received(command);
+  double t_reference = s_seconds() - t0;
+
+  Comma N;
+  CommaTally by_decoder;
+
+  t0 = s_seconds();
+  for (int p = 0; p < passes; p++)
+    N.push_block(plain, plain_length, by_decoder);
+  double t_decoder = s_seconds() - t0;
+
+  s_result("comma.push_sscanf", by_reference.m_count / t_reference, "commands/s");
+  s_result("comma.push_block_unsigned", by_decoder.m_count / t_decoder, "commands/s");
+
+  if (by_reference.m_count != by_decoder.m_count || by_reference.m_sum != by_decoder.m_sum)
+    s_error("comma: push_block and the original parser disagree");
+}
+
+/* Telemetry-like values: mostly small, occasionally large
+ */
+static void s_comma_values(CommaCommand *commands, int count) {
+  unsigned long seed = 12345;
+  for (int i = 0; i < count; i++) {
+    seed = seed * 1103515245UL + 12345UL;
+    unsigned long value = (seed >> 8) & 0xFFFFFFUL;
+    if (i % 4 == 0)
+      value &= 0x7F;
+    else if (i % 4 == 1)
+      value &= 0xFFF;
+    commands[i] = CommaCommand('a' + (i % 26), value);
+    if (i % 8 == 3)
+      commands[i].set_signed(-(long) (value & 0xFFF));
+    if (i % 8 == 7)
+      commands[i].set_float((float) value / 1000.0f);
+  }
+}
+
+static void bench_comma_binary() {
+  const int count = 1024;
+  const int group = 4; // values per multi-value frame
+
+  static CommaCommand commands[count];
+  s_comma_values(commands, count);
+
+  static char text[count * 24];
+  static char single[count * Comma::FrameSingle];
+  static char multi[count * Comma::FrameSingle];
+
+  int text_length = 0;
+  for (int i = 0; i < count; i++) {
+    ShellBuffer B(text + text_length, 24);
+    commands[i].append(B);
+    text_length += B.count();
+  }
+
+  int single_length = 0;
+  for (int i = 0; i < count; i++)
+    single_length += Comma::encode_frame(commands + i, 1, single + single_length, Comma::FrameSingle);
+
+  int multi_length = 0;
+  for (int i = 0; i < count; i += group)
+    multi_length += Comma::encode_frame(commands + i, group, multi + multi_length, Comma::FrameMax);
+
+  s_result("comma.size.text", (double) text_length / count, "bytes/command");
+  s_result("comma.size.binary", (double) single_length / count, "bytes/command");
+  s_result("comma.size.binary_x4", (double) multi_length / count, "bytes/command");
+
+  const int passes = 2000;
+
+  Comma T;
+  CommaTally by_text;
+
+  double t0 = s_seconds();
+  for (int p = 0; p < passes; p++)
+    T.push_block(text, text_length, by_text);
+  double t_text = s_seconds() - t0;
+
+  Comma B;
+  CommaTally by_single;
+
+  t0 = s_seconds();
+  for (int p = 0; p < passes; p++)
+    for (int i = 0; i < single_length; i++)
+      B.push_binary(single[i], by_single);
+  double t_single = s_seconds() - t0;
+
+  Comma M;
+  CommaTally by_multi;
+
+  t0 = s_seconds();
+  for (int p = 0; p < passes; p++)
+    for (int i = 0; i < multi_length; i++)
+      M.push_binary(multi[i], by_multi);
+  double t_multi = s_seconds() - t0;
+
+  s_result("comma.decode.text", by_text.m_count / t_text, "commands/s");
+  s_result("comma.decode.binary", by_single.m_count / t_single, "commands/s");
+  s_result("comma.decode.binary_x4", by_multi.m_count / t_multi, "commands/s");
+
+  if (by_text.m_sum != by_single.m_sum || by_text.m_sum != by_multi.m_sum)
+    s_error("comma: text and binary disagree");
+}
+
+/* Slowly-varying telemetry: a timestamp, an encoder count, a signed position, and a float
+ */
+static void s_comma_telemetry(CommaCommand *commands, int count) {
+  unsigned long seed = 54321;
+  unsigned long t = 1000000;
+  unsigned long e = 123456;
+  long x = -40000;
+  float f = 21.5f;
+  for (int i = 0; i < count; i += 4) {
+    seed = seed * 1103515245UL + 12345UL;
+    t += 10 + ((seed >> 8) & 3);
+    e += (seed >> 12) & 63;
+    x += (long) ((seed >> 20) & 255) - 128;
+    f += 0.01f * (float) ((long) ((seed >> 4) & 7) - 3);
+    commands[i]   = CommaCommand('t', t);
+    commands[i+1] = CommaCommand('e', e);
+    commands[i+2] = CommaCommand('x').set_signed(x);
+    commands[i+3] = CommaCommand('f').set_float(f);
+  }
+}
+
+static int s_comma_encode(const CommaCommand *commands, int count, char *buffer, CommaDelta *delta, bool bBinary) {
+  int length = 0;
+  for (int i = 0; i < count; i++) {
+    unsigned long d;
+    if (delta && delta->encode(commands[i], d))
+      length += Comma::encode_delta(commands[i].m_command, d, buffer + length, Task_Comma::BytesMax, bBinary);
+    else if (bBinary)
+      length += Comma::encode_frame(commands + i, 1, buffer + length, Comma::FrameSingle);
+    else {
+      ShellBuffer B(buffer + length, 24);
+      commands[i].append(B);
+      length += B.count();
+    }
+  }
+  return length;
+}
+
+static void bench_comma_delta() {
+  const int count = 1024;
+
+  static CommaCommand commands[count];
+  s_comma_telemetry(commands, count);
+
+  static char text[count * 24];
+  static char compact[count * 24];
+  static char binary[count * 24];
+  static char binary_compact[count * 24];
+
+  CommaDelta send_text;
+  CommaDelta send_binary;
+  const char *letters = "tefx";
+  for (const char *ptr = letters; *ptr; ptr++) {
+    send_text.set_compact(*ptr);
+    send_binary.set_compact(*ptr);
+  }
+
+  int text_length = s_comma_encode(commands, count, text, 0, false);
+  int compact_length = s_comma_encode(commands, count, compact, &send_text, false);
+  int binary_length = s_comma_encode(commands, count, binary, 0, true);
+  int binary_compact_length = s_comma_encode(commands, count, binary_compact, &send_binary, true);
+
+  s_result("comma.size.telemetry.text", (double) text_length / count, "bytes/command");
+  s_result("comma.size.telemetry.compact", (double) compact_length / count, "bytes/command");
+  s_result("comma.size.telemetry.binary", (double) binary_length / count, "bytes/command");
+  s_result("comma.size.telemetry.binary_compact", (double) binary_compact_length / count, "bytes/command");
+
+  const int passes = 2000;
+
+  Comma T;
+  CommaTally by_text;
+
+  double t0 = s_seconds();
+  for (int p = 0; p < passes; p++)
+    T.push_block(text, text_length, by_text);
+  double t_text = s_seconds() - t0;
+
+  CommaDelta receive;
+  Comma C;
+  C.set_delta(&receive);
+  CommaTally by_compact;
+
+  t0 = s_seconds();
+  for (int p = 0; p < passes; p++)
+    C.push_block(compact, compact_length, by_compact); // deltas continue from the previous pass
+  double t_compact = s_seconds() - t0;
+
+  s_result("comma.decode.telemetry.text", by_text.m_count / t_text, "commands/s");
+  s_result("comma.decode.telemetry.compact", by_compact.m_count / t_compact, "commands/s");
+
+  CommaDelta check_state;
+  Comma check;
+  check.set_delta(&check_state);
+  CommaTally by_check;
+  check.push_block(compact, compact_length, by_check);
+
+  CommaTally by_full;
+  Comma full;
+  full.push_block(text, text_length, by_full);
+
+  if (by_check.m_sum != by_full.m_sum || by_check.m_count != count)
+    s_error("comma: compact and text disagree");
+
+  /* the longest delta: its top digit can't hold a full 5 bits, and any more overflows and is rejected
+   */
+  static const char *radix32 = "0123456789!#$%&()*+/<=>?@[]^_{|}";
+  const int bits = 8 * (int) sizeof(unsigned long);
+  const int digits = (bits + 4) / 5;
+  const int top_max = (1 << (bits - 5 * (digits - 1))) - 1;
+
+  for (int over = 0; over < 2; over++) {
+    char line[32] = "t5,t~";
+    int length = strlen(line);
+    line[length++] = radix32[top_max + over];
+    for (int i = 1; i < digits; i++)
+      line[length++] = '0';
+    line[length++] = ',';
+
+    CommaDelta long_state;
+    Comma long_delta;
+    long_delta.set_delta(&long_state);
+    CommaTally by_long;
+    long_delta.push_block(line, length, by_long);
+    if (by_long.m_count != (over ? 1 : 2))
+      s_error(over ? "comma: overflowing delta accepted" : "comma: longest delta rejected");
+  }
+}
+
+/* The previous Task_Comma digit rendering: count digits by division, then a power-of-ten divisor per digit
+ */
+static int s_format_digits_loop(unsigned long value, char *buffer) {
+  int digits = 0;
+  if (value) {
+    digits = 1;
+    unsigned long divisor = 1;
+    while (value / divisor >= 10) {
+      ++digits;
+      divisor *= 10;
+    }
+  }
+  int count = 0;
+  while (digits) {
+    unsigned long divisor = 1;
+    for (int i = 1; i < digits; i++)
+      divisor *= 10;
+    unsigned long digit = value / divisor;
+    value -= digit * divisor;
+    --digits;
+    buffer[count++] = '0' + digit;
+  }
+  return count;
+}
+
+static void bench_comma_format() {
+  const int count = 1024;
+
+  static CommaCommand commands[count];
+  s_comma_values(commands, count);
+
+  static unsigned long values[count];
+  for (int i = 0; i < count; i++)
+    values[i] = commands[i].magnitude() | 1; // non-zero, as zero has no digits in either
+
+  const int passes = 2000;
+  unsigned long check = 0;
+  char digits[24];
+
+  double t0 = s_seconds();
+  for (int p = 0; p < passes; p++)
+    for (int i = 0; i < count; i++)
+      check += s_format_digits_loop(values[i], digits) + digits[0];
+  double t_loop = s_seconds() - t0;
+
+  unsigned long check_table = 0;
+
+  t0 = s_seconds();
+  for (int p = 0; p < passes; p++)
+    for (int i = 0; i < count; i++)
+      check_table += Comma::format_digits(values[i], digits) + digits[0];
+  double t_table = s_seconds() - t0;
+
+  s_result("comma.digits.loop", 1E9 * t_loop / ((double) passes * count), "ns/value");
+  s_result("comma.digits.table", 1E9 * t_table / ((double) passes * count), "ns/value");
+
+  if (check != check_table)
+    s_error("comma: digit formats disagree");
+}
+
+/* The previous, loop-based IEEE-754 conversion (originally by Brian "Beej Jorgensen" Hall), for comparison
+ */
+static uint32_t s_pack754_32_loop(float f) {
+  if (f == 0.0) return 0;
+
+  uint32_t sign = (f < 0) ? (1UL << 31) : 0;
+  float fnorm = sign ? (-f) : f;
+
+  int shift = 0;
+  while (fnorm >= 2.0) { fnorm /= 2.0; shift++; }
+  while (fnorm <  1.0) { fnorm *= 2.0; shift--; }
+  fnorm = fnorm - 1.0;
+
+  uint32_t significand = fnorm * ((1L << 23) + 0.5f);
+  uint32_t exp = shift + 127;
+
+  return sign | (exp << 23) | significand;
+}
+
+static float s_unpack754_32_loop(uint32_t i) {
+  if (i == 0) return 0.0;
+
+  float result = i & ((1UL << 23) - 1);
+  result /= (1UL << 23);
+  result += 1.0f;
+
+  int shift = (int) ((i >> 23) & 0xFF) - 127;
+
+  while (shift > 0) { result *= 2.0; shift--; }
+  while (shift < 0) { result /= 2.0; shift++; }
+
+  return (i & (1UL << 31)) ? (-result) : result;
+}
+
+static void bench_comma_float() {
+  const int count = 1024;
+  static float values[count];
+
+  float v = 1.0E-30f;
+  for (int i = 0; i < count; i++) {
+    values[i] = (i % 2) ? v : -v;
+    v *= 1.1f;
+  }
+
+  const int passes = 2000;
+  volatile uint32_t sink = 0;
+
+  double t0 = s_seconds();
+  for (int p = 0; p < passes; p++)
+    for (int i = 0; i < count; i++)
+      sink = sink + Comma::pack754_32(s_unpack754_32_loop(s_pack754_32_loop(values[i])));
+  double t_loop = s_seconds() - t0;
+
+  t0 = s_seconds();
+  for (int p = 0; p < passes; p++)
+    for (int i = 0; i < count; i++)
+      sink = sink + Comma::pack754_32(Comma::unpack754_32(Comma::pack754_32(values[i])));
+  double t_bits = s_seconds() - t0;
+
+  s_result("comma.float754.loop", 1E9 * t_loop / (passes * count), "ns/value");
+  s_result("comma.float754.bits", 1E9 * t_bits / (passes * count), "ns/value");
+
+  for (int i = 0; i < count; i++)
+    if (Comma::pack754_32(values[i]) != s_pack754_32_loop(values[i])) {
+      s_error("comma: pack754_32 differs from the loop version");
+      break;
+    }
+}
+
+/* ShellBuffer formatting: vsnprintf (via printf()) against operator<<, which must give identical output
+ */
+static void s_format_printf(ShellBuffer& B, int i, float coord) {
+  B.clear().printf("Free currently, OffStr: %2d/16; List: %d/2; CC: %d/16; ", i % 17, i % 3, i % 17);
+  B.printf("%3d^%02d'%.4f\"%c,", i % 180, i % 60, coord, (i % 2) ? 'N' : 'S');
+  B.printf("%.6f,%.6f,%lx", coord * 0.001f, -coord, (unsigned long) i * 2654435761UL);
+}
+
+static void s_format_stream(ShellBuffer& B, int i, float coord) {
+  B.clear() << "Free currently, OffStr: " << width(2) << i % 17 << "/16; List: " << i % 3 << "/2; CC: " << i % 17 << "/16; ";
+  B << width(3) << i % 180 << '^' << width(2, '0') << i % 60 << '\'' << precision(4) << coord << '"' << ((i % 2) ? 'N' : 'S') << ',';
+  B << precision(6) << coord * 0.001f << ',' << -coord << ',' << sb_Hex << (unsigned long) i * 2654435761UL;
+}
+
+static void bench_format() {
+  const int lines = 200000;
+
+  char buf_p[128];
+  char buf_s[128];
+  ShellBuffer P(buf_p, 128);
+  ShellBuffer S(buf_s, 128);
+
+  bool bSame = true;
+  for (int i = 0; i < 20000 && bSame; i++) {
+    float coord = (float) i * 0.0137f;
+    s_format_printf(P, i, coord);
+    s_format_stream(S, i, coord);
+    bSame = (strcmp(P.c_str(), S.c_str()) == 0);
+  }
+  if (!bSame)
+    s_error("format: printf and operator<< disagree");
+
+  /* the extremes, which need the larger scratch: very large values, and full precision
+   */
+  static const double extremes[] = { 1.7976931348623157e308, -1e300, 4.9e-324, 1e22, 0.1, 18446744073709551615.0 };
+  static char buf_x[400];
+  static char buf_y[400];
+  for (unsigned e = 0; e < sizeof(extremes) / sizeof(double); e++)
+    for (int p = 0; p <= ShellBuffer::PrecisionMax; p += 5) {
+      ShellBuffer X(buf_x, sizeof(buf_x));
+      X << precision(p) << extremes[e];
+      snprintf(buf_y, sizeof(buf_y), "%.*f", p, extremes[e]);
+      if (strcmp(X.c_str(), buf_y) != 0)
+	s_error("format: operator<< differs from printf for extreme values");
+    }
+
+  unsigned long check = 0;
+
+  double t0 = s_seconds();
+  for (int i = 0; i < lines; i++) {
+    s_format_printf(P, i, (float) i * 0.0137f);
+    check += P.count();
+  }
+  double t_printf = s_seconds() - t0;
+
+  t0 = s_seconds();
+  for (int i = 0; i < lines; i++) {
+    s_format_stream(S, i, (float) i * 0.0137f);
+    check -= S.count();
+  }
+  double t_stream = s_seconds() - t0;
+
+  s_result("format.printf", 1E9 * t_printf / lines, "ns/line");
+  s_result("format.stream", 1E9 * t_stream / lines, "ns/line");
+
+  if (check)
+    s_error("format: line lengths differ");
+}
+
+/* In-memory serial port: input is fed cyclically from a string, and output is counted and discarded,
+ * or optionally captured
+ */
+class Loopback : public VirtualSerial {
+private:
+  const char *m_input;
+  int         m_input_length;
+  int         m_input_index;
+  bool        m_bRepeat;
+  char       *m_capture;
+  int         m_capture_size;
+  int         m_captured;
+public:
+  unsigned long  m_written;
+  unsigned long  m_fed;
+
+  Loopback() : m_input(0), m_input_length(0), m_input_index(0), m_bRepeat(true), m_capture(0), m_capture_size(0), m_captured(0), m_written(0), m_fed(0) {
+    m_bActive = true;
+  }
+  virtual ~Loopback() {
+    // ...
+  }
+  inline void set_active(bool bActive) { // i.e., connect or disconnect
+    m_bActive = bActive;
+  }
+  inline void feed(const char *input) {
+    feed(input, input ? strlen(input) : 0, true);
+  }
+  inline void feed(const char *input, int length, bool bRepeat) { // e.g., once only, with binary frames
+    m_input = input;
+    m_input_length = length;
+    m_input_index = 0;
+    m_bRepeat = bRepeat;
+  }
+  inline void capture(char *buffer, int size) { // keep (the start of) the output, as a string
+    m_capture = buffer;
+    m_capture_size = size;
+    m_captured = 0;
+    if (buffer)
+      *buffer = 0;
+  }
+  virtual bool begin(const char *& status, unsigned long baud) {
+    status = "loopback";
+    return true;
+  }
+protected:
+  virtual void sync_read() {
+    if (m_input_length)
+      while (m_in.push(m_input[m_input_index])) {
+	++m_fed;
+	if (++m_input_index == m_input_length) {
+	  m_input_index = 0;
+	  if (!m_bRepeat) {
+	    m_input_length = 0;
+	    break;
+	  }
+	}
+      }
+  }
+  virtual void sync_write() {
+    char c;
+    while (m_out.pop(c)) {
+      if (m_capture && m_captured < m_capture_size - 1) {
+	m_capture[m_captured++] = c;
+	m_capture[m_captured] = 0;
+      }
+      ++m_written;
+    }
+  }
+};
+
+class BenchHandler : public ShellHandler {
+public:
+  unsigned long  m_commands;
+  unsigned long  m_comma;
+
+  BenchHandler() : m_commands(0), m_comma(0) {
+    // ...
+  }
+  virtual ~BenchHandler() {
+    // ...
+  }
+  virtual void comma_command(Shell& origin, CommaCommand& command) {
+    ++m_comma;
+  }
+  virtual void comma_vector(Shell& origin, CommaVector& vector) {
+    ++m_comma;
+  }
+  virtual CommandError shell_command(Shell& origin, Args& args) {
+    ++m_commands;
+    return ce_Okay;
+  }
+};
+
+/* Counts the control bytes reported by the stream
+ */
+class ControlResponder : public ShellStream::Responder {
+public:
+  int  m_end;
+  int  m_rsvp;
+
+  ControlResponder() : m_end(0), m_rsvp(0) {
+    // ...
+  }
+  virtual ~ControlResponder() {
+    // ...
+  }
+  virtual void stream_notification(ShellStream& stream, const char *message) {
+    if (strcmp(message, "end") == 0)
+      ++m_end;
+    if (strcmp(message, "RSVP") == 0)
+      ++m_rsvp;
+  }
+};
+
+/* A slow command: pending for a number of updates of its shell
+ */
+class SlowHandler : public BenchHandler {
+public:
+  int  m_updates;
+
+  SlowHandler(int updates) : m_updates(updates) {
+    // ...
+  }
+  virtual ~SlowHandler() {
+    // ...
+  }
+  virtual CommandError shell_command(Shell& origin, Args& args) {
+    ++m_commands;
+    if (args != "slow")
+      return ce_Okay;
+    origin.pending().m_value = m_updates;
+    return ce_Pending;
+  }
+  virtual CommandError resume_command(Shell& origin, PendingState& state) {
+    return --state.m_value ? ce_Pending : ce_Okay;
+  }
+};
+
+static void bench_shell_update() {
+  const int updates = 200000;
+
+  Loopback L;
+  ShellStream S(L);
+  BenchHandler H;
+  CommandList list(&H);
+
+  Command led("led", "led on|off", "Switch the LED on or off.");
+  Command gain("gain", "gain <value>", "Set the gain.");
+  Command report("report", "report", "Report the current state.");
+  list.add(led);
+  list.add(gain);
+  list.add(report);
+
+  SizedShell<> shell(S, list, 'b');
+  shell.set_handler(&H);
+
+  L.feed(";led on;gain 12;report;"); // the first ';' switches to shell input, and each ';' keeps it there
+
+  double t0 = s_seconds();
+  for (int i = 0; i < updates; i++)
+    shell.update();
+  double t_shell = s_seconds() - t0;
+
+  s_result("shell.update.commands", H.m_commands / t_shell, "commands/s");
+
+  /* pipelined commands processed per update: one at a time (i.e., a budget of 1), or all available
+   */
+  for (int b = 0; b < 2; b++) {
+    shell.set_command_budget(b ? 0 : 1);
+
+    unsigned long commands = H.m_commands;
+    for (int i = 0; i < 1000; i++)
+      shell.update();
+
+    s_result(b ? "shell.update.per_update.unlimited" : "shell.update.per_update.budget1", (H.m_commands - commands) / 1000.0, "commands");
+  }
+
+  L.feed(",a123,B4567890,s-250,I.1069547520,v12:34:-56:78,c0,"); // the first ',' switches back to CommaComms
+
+  unsigned long fed = L.m_fed;
+
+  t0 = s_seconds();
+  for (int i = 0; i < updates; i++)
+    shell.update();
+  double t_comma = s_seconds() - t0;
+
+  s_result("shell.update.comma", H.m_comma / t_comma, "commands/s");
+  s_result("shell.input.comma", (L.m_fed - fed) / t_comma, "bytes/s");
+
+  if (!H.m_commands || !H.m_comma)
+    s_error("shell: no input processed");
+
+  L.feed(";led on,a1,;gain 2,"); // switching modes within each span: two commands for each CommaComms value
+
+  for (int i = 0; i < 10; i++) // finish the previous input
+    shell.update();
+
+  unsigned long commands = H.m_commands;
+  unsigned long comma = H.m_comma;
+  for (int i = 0; i < 1000; i++)
+    shell.update();
+  commands = H.m_commands - commands;
+  comma = H.m_comma - comma;
+
+  if (!comma || commands + 2 < 2 * comma || commands > 2 * comma + 2)
+    s_error("shell: commands lost switching between shell and CommaComms input");
+
+  /* a long configuration line (150 characters) is too long for the default buffer, but not for a larger one
+   */
+  static char config[192];
+  strcpy(config, ";gain");
+  for (int i = 0; i < 29; i++)
+    strcat(config, " 1234");
+  strcat(config, ";");
+
+  Loopback LD;
+  Loopback LL;
+  ShellStream SD(LD);
+  ShellStream SL(LL);
+  SizedShell<>    plain(SD, list, 'd');
+  SizedShell<256> sized(SL, list, 'l');
+
+  if (sizeof(sized) - sizeof(plain) != 256 - MULTISHELL_COMMAND_BUFSIZE)
+    s_error("shell: command-line buffer not sized by SizedShell alone");
+
+  Shell *shells[2] = { &plain, &sized };
+  for (int s = 0; s < 2; s++) {
+    (s ? LL : LD).feed(config);
+
+    unsigned long before = H.m_commands;
+    for (int i = 0; i < 100; i++)
+      shells[s]->update();
+
+    bool bAccepted = (H.m_commands != before);
+    if (bAccepted != (s == 1))
+      s_error("shell: long command line mishandled");
+  }
+
+  /* control bytes are reported as text input is parsed; a binary frame read in the same span as
+   * the switch to binary, which contains a 6 (RSVP), is not reported
+   */
+  static char mixed[64];
+  int mixed_length = 0;
+  memcpy(mixed, ";binary,", 8);
+  mixed_length += 8;
+  CommaCommand six('x', 6);
+  int frame_length = Comma::encode_frame(&six, 1, mixed + mixed_length, Comma::FrameSingle);
+  if (!memchr(mixed + mixed_length, 6, frame_length))
+    s_error("shell: test frame should contain a 6");
+  mixed_length += frame_length;
+
+  Loopback LC;
+  ShellStream SC(LC);
+  ControlResponder CR;
+  SC.set_responder(&CR);
+  SizedShell<> control(SC, list, 'c');
+  control.set_handler(&H);
+
+  LC.feed(mixed, mixed_length, false);
+  unsigned long comma_before = H.m_comma;
+  for (int i = 0; i < 10; i++)
+    control.update();
+  if (CR.m_rsvp || H.m_comma != comma_before + 1)
+    s_error("shell: binary frame mistaken for control bytes");
+
+  static const char text_controls[] = { ';', 'l', 'e', 'd', ';', 6, ';', 4 };
+  control.set_binary(false);
+  LC.feed(text_controls, sizeof(text_controls), false);
+  for (int i = 0; i < 10; i++)
+    control.update();
+  if (CR.m_rsvp != 1 || CR.m_end != 1)
+    s_error("shell: control bytes in text input not reported");
+
+  /* the ACK to `binary` follows all the output queued before it, in either lane, and precedes the frames
+   */
+  Loopback LK;
+  ShellStream SK(LK);
+  SizedShell<> ack(SK, list, 'k');
+  ack.set_write_budget(8);
+
+  char out[128];
+  LK.capture(out, sizeof(out));
+
+  ack << "queued text line\n" << CommaCommand('a', 123);
+  ack.set_lane(tl_Control);
+  ack << CommaCommand('c', 1);
+  ack.set_lane(tl_Bulk);
+
+  ack.set_binary(true); // as the command `binary` does
+  ack.respond_to_RSVP();
+  ack << CommaCommand('b', 7);
+  for (int i = 0; i < 20; i++)
+    ack.update();
+  LK.capture(0, 0);
+
+  const char *ack_ptr = strchr(out, 6);
+  if (!ack_ptr || ack_ptr - out != (int) strlen("queued text line\na123,c1,") || !strstr(out, "c1,") || strlen(ack_ptr) < 2)
+    s_error("shell: ACK to binary not between the queued text and the frames");
+  ack.set_binary(false);
+
+  /* an asynchronous command holds up its own shell's input, but not another shell's
+   */
+  SlowHandler SH(50);
+  CommandList slow_list(&SH);
+  Command slow("slow", "slow", "Pending for 50 updates.");
+  Command slow_led("led", "led on|off", "Switch the LED on or off."); // a command belongs to one list only
+  slow_list.add(slow);
+  slow_list.add(slow_led);
+
+  Loopback LA;
+  Loopback LB;
+  ShellStream SA(LA);
+  ShellStream SB(LB);
+  SizedShell<> shell_a(SA, slow_list, 'a');
+  SizedShell<> shell_b(SB, list, 'b');
+
+  LA.feed(";slow;led on;");
+  LB.feed(";led on;");
+
+  unsigned long before = H.m_commands;
+  for (int i = 0; i < 40; i++) {
+    shell_a.update();
+    shell_b.update();
+  }
+  if (SH.m_commands != 1 || !shell_a.command_pending() || H.m_commands == before)
+    s_error("shell: pending command mishandled");
+  for (int i = 0; i < 20; i++)
+    shell_a.update();
+  if (SH.m_commands < 2)
+    s_error("shell: input not resumed after pending command");
+
+  /* one handler, with a slow command pending on two shells at once, keeps them apart
+   */
+  Loopback LD2;
+  Loopback LE2;
+  ShellStream SD2(LD2);
+  ShellStream SE2(LE2);
+  SizedShell<> shell_d(SD2, slow_list, 'd');
+  SizedShell<> shell_e(SE2, slow_list, 'e');
+
+  LD2.feed(";slow;", 6, false);
+  for (int i = 0; i < 20; i++)
+    shell_d.update();
+  LE2.feed(";slow;", 6, false);
+  for (int i = 0; i < 30; i++) {
+    shell_d.update();
+    shell_e.update();
+  }
+  bool bOverlap = shell_d.command_pending() && shell_e.command_pending();
+  shell_d.update(); // d's 50 updates are up, but not e's
+  shell_e.update();
+  bool bFirstDone = !shell_d.command_pending() && shell_e.command_pending();
+  for (int i = 0; i < 20; i++)
+    shell_e.update();
+  if (!bOverlap || !bFirstDone || shell_e.command_pending())
+    s_error("shell: pending commands on two shells not kept apart");
+}
+
+static unsigned long s_drain(TaskOwner<Task>& manager, ShellStream& stream, Loopback& serial) {
+  unsigned long written = serial.m_written;
+  while (manager.count()) {
+    manager.process_tasks(stream);
+    stream.update();
+  }
+  return serial.m_written - written;
+}
+
+static void s_task_result(const char *name, unsigned long bytes, double seconds) {
+  char key[64];
+  snprintf(key, sizeof(key), "tasks.%s", name);
+  s_result(key, bytes / seconds, "bytes/s");
+}
+
+static void bench_tasks() {
+  const int rounds = 20000;
+
+  static Repository R;
+  TaskOwner<Task> M;
+
+  Loopback L;
+  ShellStream S(L);
+
+  CommandList list;
+  static const char *text = "The quick brown fox jumps over the lazy dog; the lazy dog sleeps.";
+
+  static CommaCommand commands[32];
+  s_comma_values(commands, 32);
+
+  CommaVector vector('v');
+  for (int i = 0; i < 4; i++)
+    vector.push(commands[i]);
+
+  unsigned long bytes = 0;
+  double t0 = s_seconds();
+  for (int r = 0; r < rounds; r++) {
+    for (int i = 0; i < 16; i++)
+      R.dispatch_offset_string(M, text);
+    bytes += s_drain(M, S, L);
+  }
+  s_task_result("offset_string", bytes, s_seconds() - t0);
+
+  bytes = 0;
+  t0 = s_seconds();
+  for (int r = 0; r < rounds; r++) {
+    for (int i = 0; i < 4; i++)
+      R.dispatch_buffer(M, text, 60);
+    bytes += s_drain(M, S, L);
+  }
+  s_task_result("buffer", bytes, s_seconds() - t0);
+
+  bytes = 0;
+  t0 = s_seconds();
+  for (int r = 0; r < rounds; r++) {
+    R.dispatch_printable_list(M, list);
+    bytes += s_drain(M, S, L);
+  }
+  s_task_result("printable", bytes, s_seconds() - t0);
+
+  bytes = 0;
+  t0 = s_seconds();
+  for (int r = 0; r < rounds; r++) {
+    for (int i = 0; i < 16; i++)
+      R.dispatch_command(M, commands[i]);
+    bytes += s_drain(M, S, L);
+  }
+  s_task_result("comma", bytes, s_seconds() - t0);
+
+  bytes = 0;
+  t0 = s_seconds();
+  for (int r = 0; r < rounds; r++) {
+    for (int i = 0; i < 4; i++)
+      R.dispatch_vector(M, vector);
+    bytes += s_drain(M, S, L);
+  }
+  s_task_result("comma_vector", bytes, s_seconds() - t0);
+
+  bytes = 0;
+  t0 = s_seconds();
+  for (int r = 0; r < rounds; r++) {
+    R.dispatch_batch(M, commands, 32);
+    bytes += s_drain(M, S, L);
+  }
+  s_task_result("comma_batch", bytes, s_seconds() - t0);
+
+  /* a line built in a temporary buffer: copied into buffer tasks, or handed over to stream in place
+   */
+  bytes = 0;
+  t0 = s_seconds();
+  for (int r = 0; r < rounds; r++) {
+    for (int i = 0; i < 4; i++) {
+      ShellBuffer *B = R.tmp_buffer();
+      *B << text << text;
+      R.dispatch_buffer(M, *B);
+      B->return_to_owner();
+    }
+    bytes += s_drain(M, S, L);
+  }
+  s_task_result("tmp_buffer.copy", bytes, s_seconds() - t0);
+
+  bytes = 0;
+  t0 = s_seconds();
+  for (int r = 0; r < rounds; r++) {
+    for (int i = 0; i < 4; i++) {
+      ShellBuffer *B = R.tmp_buffer();
+      *B << text << text;
+      R.dispatch_owned(M, B);
+    }
+    bytes += s_drain(M, S, L);
+  }
+  s_task_result("tmp_buffer.owned", bytes, s_seconds() - t0);
+
+  if (!bytes)
+    s_error("tasks: nothing written");
+
+  /* pool churn: take a task from each pool and return it, without writing anything
+   */
+  const int cycles = 1000000;
+
+  t0 = s_seconds();
+  for (int c = 0; c < cycles; c++) {
+    R.dispatch_command(M, commands[c & 31]);
+    R.dispatch_offset_string(M, text);
+    R.dispatch_buffer(M, text, 12);
+    while (M.count())
+      M.pop_and_return();
+  }
+  s_result("repository.churn", 3 * cycles / (s_seconds() - t0), "tasks/s");
+
+  ShellBuffer *B = R.tmp_buffer(); // check that the pools are all full again
+  if (B) {
+    R.status(*B);
+    if (strstr(B->c_str(), "CC 16/16") == 0 || strstr(B->c_str(), "OffStr 16/16") == 0
+	|| strstr(B->c_str(), "SB 4/4") == 0 || strstr(B->c_str(), "BC 4/4 8/8") == 0)
+      s_error("repository: tasks not returned to pools");
+    B->return_to_owner();
+  }
+
+  /* an offset string is written up to its NUL as it is when written, not when dispatched; a NUL in a
+   * buffer is skipped
+   */
+  char out[32];
+  L.capture(out, sizeof(out));
+
+  char live[] = "status: ready";
+  R.dispatch_offset_string(M, live);
+  live[6] = 0;
+  R.dispatch_buffer(M, "|ab\0cd|", 7);
+  s_drain(M, S, L);
+  L.capture(0, 0);
+
+  if (strcmp(out, "status|abcd|") != 0)
+    s_error("tasks: output past the end of a string, or NUL in a buffer not skipped");
+}
+
+/* The same status line to four shells: copied into each shell's buffer tasks, or broadcast
+ */
+static void bench_broadcast() {
+  const int rounds = 20000;
+  const int shells = 4;
+
+  static Repository R;
+
+  TaskOwner<Task> M[shells];
+  Loopback L[shells];
+  ShellStream S[shells] = { L[0], L[1], L[2], L[3] };
+
+  Dispatcher D[shells] = { Dispatcher(M[0], R), Dispatcher(M[1], R), Dispatcher(M[2], R), Dispatcher(M[3], R) };
+  Dispatcher *targets[shells] = { &D[0], &D[1], &D[2], &D[3] };
+
+  static const char *line = "status: 12 tasks queued, 3 shells connected, battery 87%, temperature 21.5 C\n";
+
+  unsigned long copied = 0;
+
+  for (int b = 0; b < 2; b++) {
+    unsigned long bytes = 0;
+
+    double t0 = s_seconds();
+    for (int r = 0; r < rounds; r++) {
+      ShellBuffer *B = R.tmp_buffer();
+      *B << line;
+      if (b) {
+	if (Dispatcher::broadcast(targets, shells, B) != shells)
+	  s_error("broadcast: not all shells reached");
+      } else {
+	for (int s = 0; s < shells; s++)
+	  D[s].dispatch_buffer(B->buffer(), B->count());
+	B->return_to_owner();
+      }
+      for (int s = 0; s < shells; s++)
+	bytes += s_drain(M[s], S[s], L[s]);
+    }
+    s_result(b ? "broadcast.shared" : "broadcast.copied", bytes / (s_seconds() - t0), "bytes/s");
+
+    if (b && bytes != copied)
+      s_error("broadcast: output differs from copies");
+    copied = bytes;
+  }
+
+  ShellBuffer *B = R.tmp_buffer();
+  if (B) {
+    R.status(*B);
+    if (strstr(B->c_str(), "BC 4/4 8/8") == 0 || strstr(B->c_str(), "Tmp 3/4") == 0)
+      s_error("broadcast: payloads, tasks or buffers not returned");
+    B->return_to_owner();
+  }
+}
+
+/* Short lines, as from a busy command handler: how many go out per update (i.e., per process_tasks), and
+ * how many per second; previously, process_tasks completed at most one task per call
+ */
+static void bench_lines() {
+  const int rounds = 20000;
+
+  static Repository R;
+  TaskOwner<Task> M;
+
+  Loopback L;
+  ShellStream S(L);
+
+  static const char *lines[] = { "ok", "x = 12", "status: idle", "done" };
+
+  const int budgets[] = { 0, 16 };
+  for (int b = 0; b < 2; b++) {
+    M.set_write_budget(budgets[b]);
+
+    unsigned long updates = 0;
+    unsigned long written = L.m_written;
+
+    double t0 = s_seconds();
+    for (int r = 0; r < rounds; r++) {
+      for (int i = 0; i < 16; i++) {
+	R.dispatch_offset_string(M, lines[i & 3]);
+	M.push_eol();
+      }
+      while (M.count()) {
+	M.process_tasks(S);
+	S.update();
+	++updates;
+      }
+    }
+    double t_lines = s_seconds() - t0;
+
+    char key[64];
+    snprintf(key, sizeof(key), "lines.%s.per_update", b ? "budget16" : "unlimited");
+    s_result(key, 16.0 * rounds / updates, "lines");
+    snprintf(key, sizeof(key), "lines.%s.rate", b ? "budget16" : "unlimited");
+    s_result(key, 16.0 * rounds / t_lines, "lines/s");
+
+    if (L.m_written - written != (unsigned long) rounds * (3 + 7 + 13 + 5) * 4)
+      s_error("lines: output length mismatch");
+  }
+  M.set_write_budget(0);
+}
+
+/* Records how much had been written when it was reached
+ */
+class MarkTask : public Task {
+public:
+  Loopback     *m_serial;
+  unsigned long m_reached;
+
+  MarkTask(Loopback& serial) : m_serial(&serial), m_reached(0) {
+    // ...
+  }
+  virtual ~MarkTask() { }
+
+  virtual bool process_task(ShellStream& stream, int& afw) {
+    m_reached = m_serial->m_written;
+    return true;
+  }
+};
+
+static void bench_lanes() {
+  static Repository R;
+  TaskOwner<Task> M;
+
+  Loopback L;
+  ShellStream S(L);
+
+  CommandList list;
+  unsigned long total = 0;
+
+  for (int i = 0; i < 2; i++) { // the mark queued behind a listing, in the bulk lane and then the control lane
+    TaskLane lane = i ? tl_Control : tl_Bulk;
+
+    MarkTask mark(L);
+    unsigned long start = L.m_written;
+
+    R.dispatch_printable_list(M, list);
+    R.dispatch_printable_list(M, list);
+    M.process_tasks(S);
+    S.update();
+
+    M.set_lane(lane);
+    M.push(mark);
+    M.set_lane(tl_Bulk);
+
+    s_drain(M, S, L);
+
+    s_result(i ? "lanes.latency.control" : "lanes.latency.bulk", (double) (mark.m_reached - start), "bytes");
+
+    if (!mark.m_reached)
+      s_error("lanes: mark not reached");
+    if (i && L.m_written - start != total)
+      s_error("lanes: output differs between lanes");
+    total = L.m_written - start;
+  }
+}
+
+/* Counts capacity_returned() notifications
+ */
+class CountWaiter : public Dispatcher::Waiter {
+public:
+  int m_count;
+
+  CountWaiter() : m_count(0) {
+    // ...
+  }
+  virtual ~CountWaiter() { }
+
+  virtual void capacity_returned(Dispatcher& dispatcher) {
+    ++m_count;
+  }
+};
+
+/* A producer that outpaces the stream: 8 lines per update against a 16-byte write budget; blind, it loses
+ * lines once the offset-string pool runs dry, whereas throttled by available() it only falls behind
+ */
+class BinaryDispatcher : public Dispatcher { // as a shell in binary mode
+public:
+  BinaryDispatcher(TaskOwner<Task>& manager, Repository& repository) :
+    Dispatcher(manager, repository)
+  {
+    set_binary_mode(true);
+  }
+};
+
+static void bench_backpressure() {
+  const int lines = 8000;
+
+  static Repository R;
+  TaskOwner<Task> M;
+  M.set_write_budget(16);
+
+  Loopback L;
+  ShellStream S(L);
+
+  Dispatcher D(M, R);
+  CountWaiter W;
+  D.set_waiter(&W);
+
+  static const char *line = "sample 0123456789\n";
+  const unsigned long length = strlen(line);
+
+  for (int b = 0; b < 2; b++) {
+    unsigned long dropped = D.dropped();
+    unsigned long written = L.m_written;
+    unsigned long updates = 0;
+
+    int pending = lines;
+    while (pending || M.count()) {
+      for (int i = 0; i < 8 && pending; i++) {
+	if (b && !D.available(rp_OffsetString))
+	  break;
+	D.dispatch_offset_string(line);
+	--pending;
+      }
+      M.process_tasks(S);
+      S.update();
+      D.check_capacity();
+      ++updates;
+    }
+    dropped = D.dropped() - dropped;
+    written = L.m_written - written;
+
+    s_result(b ? "backpressure.throttled.dropped" : "backpressure.blind.dropped", (double) dropped, "lines");
+    s_result(b ? "backpressure.throttled.updates" : "backpressure.blind.updates", (double) updates, "updates");
+
+    if (written != (lines - dropped) * length)
+      s_error("backpressure: output does not match lines accepted");
+    if (b ? (dropped != 0) : (dropped == 0 || W.m_count == 0))
+      s_error("backpressure: unexpected drops or missing notification");
+    if (D.waiting())
+      s_error("backpressure: still waiting after drain");
+  }
+  if (D.dropped() != R.dropped(rp_OffsetString))
+    s_error("backpressure: shell and pool drop counts differ");
+  M.set_write_budget(0);
+
+  /* pool usage: a small buffer falling back to a larger one is not a failure, only running out of all three
+   */
+  typedef RepositoryConfig C;
+
+  static Repository RU;
+  TaskOwner<Task> MU;
+
+  static char chunk[C::SmallBufSize];
+  memset(chunk, 'x', sizeof(chunk));
+
+  char buf_u[256];
+  char buf_e[64];
+  ShellBuffer U(buf_u, sizeof(buf_u));
+  ShellBuffer E(buf_e, sizeof(buf_e));
+
+  for (int i = 0; i < C::SmallBuffers + C::MediumBuffers; i++)
+    RU.dispatch_buffer(MU, chunk, sizeof(chunk));
+  RU.usage(U);
+  E << ", Buf " << C::SmallBuffers << "/0 " << C::MediumBuffers << "/0 0/0,";
+  if (!strstr(U.c_str(), E.c_str()))
+    s_error("pool usage: fallback counted as a failure");
+
+  while (RU.dispatch_buffer(MU, chunk, sizeof(chunk)))
+    ;
+  U.clear();
+  E.clear();
+  RU.usage(U);
+  E << ", Buf " << C::SmallBuffers << "/1 " << C::MediumBuffers << "/0 " << C::LargeBuffers << "/0,";
+  if (!strstr(U.c_str(), E.c_str()))
+    s_error("pool usage: exhaustion not counted");
+
+  U.clear();
+  E.clear();
+  RU.status(U);
+  E << ", Buf 0/" << C::SmallBuffers << " 0/" << C::MediumBuffers << " 0/" << C::LargeBuffers << ",";
+  if (!strstr(U.c_str(), E.c_str()))
+    s_error("pool status: buffers not all in use");
+
+  s_drain(MU, S, L);
+
+  /* a binary vector too large for one frame is rejected, and counted as dropped, rather than sent empty
+   */
+  BinaryDispatcher DV(MU, RU);
+
+  CommaVector small('v');
+  CommaVector large('v');
+  for (int i = 0; i < CommaVector::Capacity; i++) {
+    small.push_unsigned(i);
+    large.push_unsigned(~0UL);
+  }
+  char frame[Comma::FrameMax];
+  bool bFits = Comma::encode_frame(large, frame, sizeof(frame)) > 0; // only with 32-bit longs
+
+  unsigned long dropped = DV.dropped();
+  unsigned long pool_dropped = RU.dropped(rp_CommaVector);
+  if (!DV.dispatch_vector(small) || DV.dropped() != dropped)
+    s_error("binary vector: small vector not sent");
+  if (DV.dispatch_vector(large) != bFits || DV.dropped() != dropped + (bFits ? 0 : 1))
+    s_error("binary vector: oversize vector not rejected");
+  if (DV.waiting() || RU.dropped(rp_CommaVector) != pool_dropped)
+    s_error("binary vector: rejection counted as the pool running dry");
+  if (RU.available(rp_CommaVector) != C::CommaVectors - (bFits ? 2 : 1))
+    s_error("binary vector: rejected task not returned to pool");
+  if (s_drain(MU, S, L) == 0)
+    s_error("binary vector: nothing written");
+  if (RU.available(rp_CommaVector) != C::CommaVectors)
+    s_error("binary vector: tasks not returned to pool");
+}
+
+/* Coalescing: queued values are replaced by the latest of the same letter, in place, and their time to
+ * live starts again
+ */
+static void bench_coalesce() {
+  static Repository R;
+  TaskOwner<Task> M;
+
+  Loopback L;
+  ShellStream S(L);
+
+  Dispatcher D(M, R);
+  D.set_coalescing(true);
+
+  char out[64];
+  L.capture(out, sizeof(out));
+
+  static const char letters[] = "abacab";
+  for (int i = 0; i < 6; i++)
+    D.dispatch_command(CommaCommand(letters[i], i + 1));
+  if (D.dispatch_command(CommaCommand()))
+    s_error("coalesce: null command accepted");
+  s_drain(M, S, L);
+
+  s_result("coalesce.replaced", (double) D.coalesced(), "values");
+
+  if (strcmp(out, "a5,b6,c4,") != 0 || D.coalesced() != 3)
+    s_error("coalesce: not the latest values, or out of order");
+
+  /* a replaced value lives on; without the fresh deadline, it would expire
+   */
+  L.capture(out, sizeof(out));
+  D.set_time_to_live(20);
+  D.dispatch_command(CommaCommand('t', 1));
+
+  double t0 = s_seconds();
+  while (s_seconds() - t0 < 0.015) { }
+  D.dispatch_command(CommaCommand('t', 2));
+  while (s_seconds() - t0 < 0.030) { }
+
+  s_drain(M, S, L);
+  D.set_time_to_live(0);
+
+  if (strcmp(out, "t2,") != 0)
+    s_error("coalesce: replaced value expired early");
+
+  /* each lane coalesces separately
+   */
+  L.capture(out, sizeof(out));
+  D.dispatch_command(CommaCommand('x', 1));
+  D.set_lane(tl_Control);
+  D.dispatch_command(CommaCommand('x', 2));
+  D.set_lane(tl_Bulk);
+  s_drain(M, S, L);
+
+  if (strcmp(out, "x2,x1,") != 0)
+    s_error("coalesce: value moved between lanes");
+  L.capture(0, 0);
+}
+
+static void s_stale_line(Dispatcher& D, Repository& R, const char *line, int i) {
+  ShellBuffer *B = (i < 2) ? R.tmp_buffer() : 0; // one in each lane is an owned buffer
+  if (B)
+    D.dispatch_owned(&(*B << line));
+  else
+    D.dispatch_offset_string(line);
+}
+
+/* Stale output: telemetry queued behind a slow stream, or while disconnected; how much of it is sent
+ * once the stream catches up, with and without a time to live, and with each disconnect policy
+ */
+static void bench_stale() {
+  const int lines = 12;
+
+  static Repository R;
+  TaskOwner<Task> M;
+
+  Loopback L;
+  ShellStream S(L);
+
+  Dispatcher D(M, R);
+
+  static const char *line = "t,12.5,4.25,-0.125\n";
+  const unsigned long length = strlen(line);
+
+  for (int t = 0; t < 2; t++) { // without, and then with, a time to live of 1ms
+    D.set_time_to_live(t);
+    for (int i = 0; i < lines; i++)
+      s_stale_line(D, R, line, i);
+
+    double t0 = s_seconds();
+    while (s_seconds() - t0 < 0.002) { } // the stream is slow
+
+    unsigned long sent = s_drain(M, S, L);
+    s_result(t ? "stale.ttl.sent" : "stale.none.sent", (double) sent, "bytes");
+
+    if (sent != (t ? 0 : lines * length))
+      s_error("stale: expired output sent, or live output discarded");
+  }
+  D.set_time_to_live(0);
+
+  static const DisconnectPolicy policies[] = { dp_KeepAll, dp_KeepControl, dp_FlushAll };
+  static const char *names[] = { "stale.keep_all.sent", "stale.keep_control.sent", "stale.flush_all.sent" };
+
+  for (int p = 0; p < 3; p++) {
+    D.set_disconnect_policy(policies[p]);
+
+    L.set_active(false);
+    for (int i = 0; i < lines; i++) {
+      D.set_lane((i & 1) ? tl_Control : tl_Bulk);
+      s_stale_line(D, R, line, i);
+      M.process_tasks(S);
+    }
+    D.set_lane(tl_Bulk);
+    L.set_active(true);
+
+    unsigned long sent = s_drain(M, S, L);
+    s_result(names[p], (double) sent, "bytes");
+
+    if (sent != (unsigned long) (2 - p) * (lines / 2) * length)
+      s_error("stale: disconnect policy not applied");
+  }
+  D.set_disconnect_policy(dp_KeepAll);
+
+  ShellBuffer *B = R.tmp_buffer();
+  if (B) {
+    R.status(*B);
+    if (strstr(B->c_str(), "OffStr 16/16") == 0 || strstr(B->c_str(), "SB 4/4") == 0 || strstr(B->c_str(), "Tmp 3/4") == 0)
+      s_error("stale: discarded tasks or buffers not returned");
+    B->return_to_owner();
+  }
+  if (M.discarded() != lines + lines / 2 + lines)
+    s_error("stale: discarded count mismatch");
+}
+
+/* Argument handling, as by a command handler: each argument in turn with sscanf(), or typed access
+ */
+/* CommaRouter: by letter to a handler or a callback, with range checks, and anything else to the fallback
+ */
+static void s_route_callback(void *context, Shell& origin, CommaCommand& command) {
+  *(unsigned long *) context += command.as_unsigned();
+}
+
+static void bench_router() {
+  BenchHandler routed;
+  BenchHandler fallback;
+  unsigned long sum = 0;
+
+  static const CommaRoute routes[] = {
+    CommaRoute('a', routed, 0, 100),
+    CommaRoute('b', s_route_callback, &sum)
+  };
+  CommaRouter router(routes, 2, &fallback);
+
+  if (router.add(0) || router.route('c') || router.route('a') != &routes[0])
+    s_error("router: table not as added");
+
+  Loopback L;
+  ShellStream S(L);
+  CommandList list;
+  SizedShell<> shell(S, list, 'r');
+  shell.set_handler(&router);
+
+  static const char input[] = ",a50,a200,b5,b7,z1,v1:2:3,a1:2,a1:101,";
+  L.feed(input, sizeof(input) - 1, false);
+  for (int i = 0; i < 10; i++)
+    shell.update();
+
+  if (routed.m_comma != 2 || sum != 12 || fallback.m_comma != 2 || router.rejected() != 2)
+    s_error("router: commands misrouted, or range checks not applied");
+
+  L.feed(",a50,b5,z1,");
+
+  unsigned long before = routed.m_comma + fallback.m_comma + sum / 5;
+
+  double t0 = s_seconds();
+  for (int i = 0; i < 100000; i++)
+    shell.update();
+  double t_route = s_seconds() - t0;
+
+  s_result("router.commands", (routed.m_comma + fallback.m_comma + sum / 5 - before) / t_route, "commands/s");
+}
+
+static void bench_args() {
+  const int rounds = 500000;
+
+  static const char *command = "motor -45 120 \"slow mode\" 0.75";
+
+  long check[2] = { 0, 0 };
+
+  for (int b = 0; b < 2; b++) {
+    double t0 = s_seconds();
+    for (int r = 0; r < rounds; r++) {
+      char buffer[64];
+      strcpy(buffer, command);
+
+      Args args(buffer);
+      int   left  = 0;
+      int   right = 0;
+      float gain  = 0;
+      if (b) {
+	args.to_int(1, left);
+	args.to_int(2, right);
+	args.to_float(4, gain);
+      } else {
+	sscanf((++args).c_str(), "%d", &left);
+	sscanf((++args).c_str(), "%d", &right);
+	++args;
+	sscanf((++args).c_str(), "%f", &gain);
+      }
+      check[b] += left + right + (long) (gain * 100) + strlen(args[3]);
+    }
+    s_result(b ? "args.typed" : "args.sscanf", 1E9 * (s_seconds() - t0) / rounds, "ns/command");
+  }
+  if (check[0] != check[1] || check[1] != (long) rounds * (-45 + 120 + 75 + 9))
+    s_error("args: typed arguments differ from sscanf");
+}
+
+static void bench_plot() {
+  const int plots = 2000;
+
+  Loopback L;
+  ShellStream S(L);
+  TaskOwner<Task> M;
+
+  PlotTask plot;
+  TaskOwner<PlotTask> plot_home;
+  plot_home.push(plot, true);
+
+  char data_a[128];
+  char data_b[128];
+  ShellBuffer A(data_a, 128);
+  ShellBuffer B(data_b, 128);
+  ItemOwner<ShellBuffer> data_home;
+  data_home.push(A, true);
+  data_home.push(B, true);
+
+  for (int i = 0; i <= 100; i++) { // as the two-line plot demo
+    if (i < 55)
+      A << (char) (-10 + i);
+    B << (char) (-90 + i);
+  }
+
+  unsigned long bytes = 0;
+  double t0 = s_seconds();
+  for (int p = 0; p < plots; p++) {
+    PlotTask *P = plot_home.pop();
+    P->push(*data_home.pop());
+    P->push(*data_home.pop());
+    P->prepare();
+    M.push(*P);
+    bytes += s_drain(M, S, L);
+  }
+  double t_plot = s_seconds() - t0;
+
+  s_result("plot.render", 1E6 * t_plot / plots, "us/plot");
+  s_result("plot.bytes", (double) bytes / plots, "bytes/plot");
+
+  if (data_home.count() != 2 || plot_home.count() != 1)
+    s_error("plot: task or datasets not returned");
+}
+
+class BenchItem : public LinkedItem {
+public:
+  int m_value;
+
+  BenchItem() : m_value(0) {
+    // ...
+  }
+  virtual ~BenchItem() { }
+};
+
+static void bench_list() {
+  const int max_items = 4096;
+
+  static BenchItem items[max_items];
+  for (int i = 0; i < max_items; i++)
+    items[i].m_value = i;
+
+  const int sizes[] = { 16, 256, 4096 };
+  for (int s = 0; s < 3; s++) {
+    int n = sizes[s];
+    int passes = 1 + 2000000 / n; // push and iteration are O(1) per item
+
+    ItemOwner<BenchItem> list;
+    long sum = 0;
+
+    double t_push = 0;
+    double t_iterate = 0;
+
+    for (int p = 0; p < passes; p++) {
+      double t0 = s_seconds();
+      for (int i = 0; i < n; i++)
+	list.push(items[i]);
+      double t1 = s_seconds();
+      for (const BenchItem& item : list)
+	sum += item.m_value;
+      double t2 = s_seconds();
+      t_push += t1 - t0;
+      t_iterate += t2 - t1;
+
+      while (list.count())
+	list.pop();
+    }
+
+    char key[64];
+    snprintf(key, sizeof(key), "linkedlist.push.%d", n);
+    s_result(key, 1E9 * t_push / ((double) passes * n), "ns/item");
+    snprintf(key, sizeof(key), "linkedlist.iterate.%d", n);
+    s_result(key, 1E9 * t_iterate / ((double) passes * n), "ns/item");
+
+    if (sum != (long) passes * n * (n - 1) / 2)
+      s_error("linkedlist: iteration mismatch");
+  }
+}
+
+/* A command table built from names checked at compile time to be in order (the table itself is checked
+ * only at runtime, by add_table())
+ */
+static constexpr const char *s_table_names[] = { "get", "led", "list", "log", "motor", "plot", "set", "stop" };
+static_assert(command_names_sorted(s_table_names), "benchmark command table not in name order");
+
+static Command s_table[] = {
+  { s_table_names[0], "get <name>" },
+  { s_table_names[1], "led on|off" },
+  { s_table_names[2], "list" },
+  { s_table_names[3], "log start|stop" },
+  { s_table_names[4], "motor <left> <right>" },
+  { s_table_names[5], "plot" },
+  { s_table_names[6], "set <name> <value>" },
+  { s_table_names[7], "stop" }
+};
+
+/* Lookup cost per command, against the number of commands; a linear search of all n is O(n^2)
+ */
+static double s_lookups(const CommandList& list, char (*names)[8], int n) {
+  const int lookups = 1 + 1000000 / n;
+  int found = 0;
+
+  double t0 = s_seconds();
+  for (int l = 0; l < lookups; l++)
+    for (int i = 0; i < n; i++)
+      if (list.lookup(names[i]))
+	++found;
+  double t_lookup = s_seconds() - t0;
+
+  if (found != lookups * n)
+    s_error("commandlist: lookup failed");
+
+  return 1E9 * t_lookup / ((double) lookups * n);
+}
+
+static void bench_lookup() {
+  const int max_commands = 256;
+
+  static Repository R;
+  TaskOwner<Task> M;
+
+  Loopback L;
+  ShellStream S(L);
+
+  static char names[max_commands][8];
+  static Command *commands[max_commands];
+
+  Command *table = (Command *) ::operator new(max_commands * sizeof(Command)); // in name order, as for add_table()
+
+  for (int i = 0; i < max_commands; i++) {
+    snprintf(names[i], 8, "cmd%03d", i);
+    commands[i] = new Command(names[i], names[i], "Benchmark command."); // setup only; never freed
+    new (table + i) Command(names[i], names[i], "Benchmark command.");
+  }
+
+  const int sizes[] = { 4, 16, 64, 256 };
+  for (int s = 0; s < 4; s++) {
+    int n = sizes[s];
+
+    CommandList list;
+    for (int i = 0; i < n; i++)
+      list.add(*commands[i]);
+
+    /* listing the commands (cf. help) walks the list once, so the cost per command should not grow with n
+     */
+    const int listings = 1 + 20000 / n;
+
+    double t0 = s_seconds();
+    for (int l = 0; l < listings; l++) {
+      R.dispatch_printable_list(M, list);
+      s_drain(M, S, L);
+    }
+    double t_list = s_seconds() - t0;
+
+    char key[64];
+    snprintf(key, sizeof(key), "commandlist.list.%d", n);
+    s_result(key, 1E9 * t_list / ((double) listings * n), "ns/command");
+
+    snprintf(key, sizeof(key), "commandlist.lookup.%d", n); // indexed, up to MULTISHELL_COMMAND_INDEX
+    s_result(key, s_lookups(list, names, n), "ns/lookup");
+
+    while (list.count()) // CommandList is an ItemOwner; release the commands for the next list
+      list.pop();
+
+    CommandList tlist;
+    tlist.add_table(table, n);
+
+    snprintf(key, sizeof(key), "commandlist.table.%d", n);
+    s_result(key, s_lookups(tlist, names, n), "ns/lookup");
+
+    while (tlist.count())
+      tlist.pop();
+  }
+
+  CommandList list;
+  list.add_table(s_table, sizeof(s_table) / sizeof(s_table[0]));
+  for (const char *name : s_table_names)
+    if (!list.lookup(name) || strcmp(list.lookup(name)->command(), name))
+      s_error("commandlist: table lookup failed");
+  if (!list.lookup("help") || list.lookup("motors"))
+    s_error("commandlist: lookup found wrong command");
+
+  /* the first added wins, whether in the index or the table: the built-in help, then the table's led
+   */
+  Command late_led("led", "led <brightness>");
+  list.add(late_led);
+  if (list.lookup("led") != &s_table[1])
+    s_error("commandlist: later command shadows the table");
+  while (list.count())
+    list.pop();
+
+  static Command shadowed[] = { { "help", "help <topic>" }, { "zoom", "zoom <factor>" } };
+  static Command unsorted[] = { { "stop", "stop" }, { "go", "go" }, { "pause", "pause" } };
+
+  CommandList ulist;
+  ulist.add_table(unsorted, 3); // out of order, so indexed instead
+  ulist.add_table(shadowed, 2);
+  if (ulist.lookup("go") != &unsorted[1] || ulist.lookup("pause") != &unsorted[2] || ulist.lookup("zoom") != &shadowed[1])
+    s_error("commandlist: unsorted table lookup failed");
+  if (!ulist.lookup("help") || ulist.lookup("help") == &shadowed[0])
+    s_error("commandlist: table shadows an earlier command");
+  while (ulist.count())
+    ulist.pop();
+
+  CommandList slist;
+  slist.add_table(shadowed, 2); // in order, and searched in place
+  if (!slist.lookup("help") || slist.lookup("help") == &shadowed[0] || slist.lookup("zoom") != &shadowed[1])
+    s_error("commandlist: table shadows an earlier command");
+  while (slist.count())
+    slist.pop();
+}
+
+int main(int argc, char **argv) {
+  printf("{\n  \"suite\": \"multishell\",\n  \"results\": [");
+
+  bench_comma_push();
+  bench_comma_binary();
+  bench_comma_delta();
+  bench_comma_format();
+  bench_comma_float();
+
+  bench_format();
+  bench_shell_update();
+  bench_router();
+  bench_args();
+  bench_tasks();
+  bench_lines();
+  bench_broadcast();
+  bench_lanes();
+  bench_backpressure();
+  bench_coalesce();
+  bench_stale();
+  bench_plot();
+  bench_list();
+  bench_lookup();
+
+  printf("\n  ]\n}\n");
+  return s_error_count ? 1 : 0;
+}
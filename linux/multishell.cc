@@ -14,25 +14,33 @@ using namespace MultiShell;
 
 Command sc_plott("plot", "plot <option>", "Test plotting capability; <option> = [0],1,2,...");
 Command sc_unimp("eh",   "eh",            "Unimplemented command");
+Command sc_sleep("wait", "wait <ms>",     "Wait without blocking; further input waits too.");
 
 class LocalShell : public Timer, public ShellStream::Responder, public ShellHandler {
 private:
   CommandList  m_list;
+  CommaRouter  m_router;
+  CommaRoute   m_gain;
   char         m_buftmp[128];
   ShellBuffer  m_B;
-  Shell        m_one;
+  SizedShell<> m_one;
   ShellPlot    m_plot;
 public:
   LocalShell(ShellStream& terminal) :
     m_list(this),
+    m_router(this),
+    m_gain(CommaRoute::member<LocalShell, &LocalShell::set_gain>('P', *this, 0, 100)),
     m_B(m_buftmp, 128),
     m_one(terminal, m_list, '0')
   {
     m_list.add(sc_plott);
     m_list.add(sc_unimp);
+    m_list.add(sc_sleep);
+
+    m_router.add(&m_gain);
 
     terminal.set_responder(this);
-    m_one.set_handler(this);
+    m_one.set_handler(&m_router);
   }
 
   virtual ~LocalShell() {
@@ -71,11 +79,33 @@ public:
     fprintf(stderr, "\n=== Note {%s}: %s ===\n", origin.name(), message);
   }
 
+  void set_gain(Shell& origin, CommaCommand& command) { // routed 'P', in range 0-100
+    fprintf(stderr, "\n=== Gain {%s}: %g ===\n", origin.name(), command.as_float());
+  }
+
   virtual void comma_command(Shell& origin, CommaCommand& command) {
-    fprintf(stderr, "\n=== CC {%s}: %c %lu ===\n", origin.name(), command.m_command, command.m_value);
+    if (command.m_type == ct_Float)
+      fprintf(stderr, "\n=== CC {%s}: %c %g ===\n", origin.name(), command.m_command, command.as_float());
+    else if (command.m_type == ct_Signed)
+      fprintf(stderr, "\n=== CC {%s}: %c %ld ===\n", origin.name(), command.m_command, command.as_signed());
+    else
+      fprintf(stderr, "\n=== CC {%s}: %c %lu ===\n", origin.name(), command.m_command, command.m_value);
     // ...
   }
 
+  virtual void comma_vector(Shell& origin, CommaVector& vector) {
+    fprintf(stderr, "\n=== CV {%s}: %c", origin.name(), vector.m_command);
+    for (int i = 0; i < vector.count(); i++) {
+      if (vector[i].m_type == ct_Float)
+	fprintf(stderr, " %g", vector[i].as_float());
+      else if (vector[i].m_type == ct_Signed)
+	fprintf(stderr, " %ld", vector[i].as_signed());
+      else
+	fprintf(stderr, " %lu", vector[i].as_unsigned());
+    }
+    fprintf(stderr, " ===\n");
+  }
+
   virtual CommandError shell_command(Shell& origin, Args& args) {
     fprintf(stderr, "\n=== Shell {%s}: %s ===\n", origin.name(), args.c_str());
 
@@ -83,12 +113,14 @@ public:
 
     if (args == "plot") {
       int option = 0;
-      if (++args != "") {
-	if (sscanf(args.c_str(), "%d", &option) != 1) {
-	  option = 0;
-	}
-      }
+      args.to_int(1, option);
       m_plot.demo(option, origin, this);
+    } else if (args == "wait") {
+      unsigned ms = 0;
+      if (!args.to_uint(1, ms))
+	return ce_IncorrectUsage;
+      origin.pending().m_value = ms; // kept per shell, so that several shells can wait at once
+      ce = ce_Pending;
     } else {
       origin << "Oops! Command: \"" << args << "\"" << 0;
       while (++args != "") {
@@ -98,6 +130,15 @@ public:
     }
     return ce;
   }
+
+  virtual CommandError resume_command(Shell& origin, PendingState& state) { // i.e., wait
+    if (millis() - state.m_since < state.m_value)
+      return ce_Pending;
+    m_B = "Waited ";
+    m_B << state.m_value << "ms";
+    origin << m_B << 0;
+    return ce_Okay;
+  }
 };
 
 class Passthrough : public Timer, public ShellStream::Responder {
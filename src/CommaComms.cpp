@@ -7,87 +7,447 @@
 
 using namespace MultiShell;
 
-// Pack754 Code originally by Brian "Beej Jorgensen" Hall in his Guide to Network Programming
+static inline bool s_is_letter(char c) {
+  return (unsigned char) ((c | 0x20) - 'a') < 26;
+}
 
-uint32_t Comma::pack754_32(float f) {
-  const unsigned bits = 32;
-  const unsigned expbits = 8;
-  const unsigned bias = (1 << (expbits - 1)) - 1;
-  const unsigned significandbits = bits - expbits - 1; // -1 for sign bit
-  const uint32_t signbit = 1UL << (bits - 1);
+static inline bool s_is_digit(char c) {
+  return (unsigned char) (c - '0') < 10;
+}
 
-  if (f == 0.0) return 0; // get this special case out of the way
+static inline bool s_is_marker(char c) {
+  return (c == '-') || (c == '.');
+}
 
-  // check sign and begin normalization
-  uint32_t sign = (f < 0) ? signbit : 0;
-  float fnorm = sign ? (-f) : f;
+/* Compact (delta) values in text: base-32, most significant digit first
+ */
+static const char s_radix32[] = "0123456789!#$%&()*+/<=>?@[]^_{|}";
 
-  // get the normalized form of f and track the exponent
-  int shift = 0;
-  while (fnorm >= 2.0) { fnorm /= 2.0; shift++; }
-  while (fnorm <  1.0) { fnorm *= 2.0; shift--; }
-  fnorm = fnorm - 1.0;
+static const signed char s_radix32_value[96] = { // from ' ' to DEL
+  -1, 10, -1, 11, 12, 13, 14, -1, 15, 16, 17, 18, -1, -1, -1, 19,
+   0,  1,  2,  3,  4,  5,  6,  7,  8,  9, -1, -1, 20, 21, 22, 23,
+  24, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 25, -1, 26, 27, 28,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 29, 30, 31, -1, -1,
+};
 
-  // calculate the binary form (non-float) of the significand data
-  uint32_t significand = fnorm * ((1L << significandbits) + 0.5f);
+static inline int s_radix32_digit(char c) { // returns -1 if not a base-32 digit
+  unsigned char i = (unsigned char) c - 32;
+  return (i < 96) ? s_radix32_value[i] : -1;
+}
 
-  // get the biased exponent
-  uint32_t exp = shift + bias; // shift + bias
+static const int s_radix32_max = (8 * (int) sizeof(unsigned long) + 4) / 5; // max. digits in a delta
 
-  // return the final answer
-  return sign | (exp << significandbits) | significand;
-}
+bool CommaDelta::encode(const CommaCommand& command, unsigned long& delta) {
+  int i = index(command.m_command);
+  if (i < 0)
+    return false;
 
-float Comma::unpack754_32(uint32_t i) {
-  const unsigned bits = 32;
-  const unsigned expbits = 8;
-  const uint32_t expmask = (1UL << expbits) - 1;
-  const unsigned bias = (1 << (expbits - 1)) - 1;
-  const unsigned significandbits = bits - expbits - 1; // -1 for sign bit
-  const uint32_t significandmask = (1UL << significandbits) - 1;
-  const uint32_t signbit = 1UL << (bits - 1);
+  CommaType type = command.wire_type();
 
-  if (i == 0) return 0.0; // get this special case out of the way
+  bool bDelta = (m_flags[i] & f_Valid) && ((m_flags[i] & f_Type) == type);
+  if (bDelta) {
+    unsigned long d = command.m_value - m_last[i]; // zigzag: 0, -1, 1, -2, ... => 0, 1, 2, 3, ...
+    delta = (d << 1) ^ (0UL - (d >> (8 * sizeof(unsigned long) - 1)));
+  }
+  m_last[i] = command.m_value;
+  m_flags[i] = (m_flags[i] & f_Compact) | f_Valid | type;
+  return bDelta;
+}
 
-  // extract and reconstruct the significand
-  float result = i & significandmask;
-  result /= (1UL << significandbits);
-  result += 1.0f;
+bool CommaDelta::decode(CommaCommand& command, unsigned long delta) {
+  int i = index(command.m_command);
+  if (i < 0 || !(m_flags[i] & f_Valid)) {
+    ++m_missed;
+    return false;
+  }
+  m_last[i] += (delta >> 1) ^ (0UL - (delta & 1));
 
-  // extract exponent and remove bias
-  uint32_t exp = (i >> significandbits) & expmask;
-  int shift = (int) exp - bias;
+  command.m_type = (CommaType) (m_flags[i] & f_Type);
+  command.m_value = m_last[i];
+  return true;
+}
 
-  while (shift > 0) { result *= 2.0; shift--; }
-  while (shift < 0) { result /= 2.0; shift++; }
+#if defined(OS_Linux) && defined(__x86_64__)
+#define COMMA_SWAR_DIGITS
+/* Convert 8 ASCII digits at once (SIMD within a register); x86_64 is little-endian and has 64-bit unsigned long
+ */
+static inline unsigned long s_swar_8_digits(const char *ptr) {
+  uint64_t v;
+  memcpy(&v, ptr, 8);
+  v = ((v & 0x0F0F0F0F0F0F0F0FULL) * 2561) >> 8;
+  v = ((v & 0x00FF00FF00FF00FFULL) * 6553601) >> 16;
+  v = ((v & 0x0000FFFF0000FFFFULL) * 42949672960001ULL) >> 32;
+  return (unsigned long) v;
+}
+#endif
+
+namespace {
+  class SingleSink : public Comma::Sink { // for push(char, CommaCommand&), which predates push_block()
+  public:
+    CommaCommand *m_command;
 
-  return (i & signbit) ? (-result) : result;
+    SingleSink(CommaCommand& command) : m_command(&command) {
+      // ...
+    }
+    virtual ~SingleSink() {
+      // ...
+    }
+    virtual void comma_received(CommaCommand& command) {
+      *m_command = command;
+    }
+  };
 }
 
 bool Comma::push(char next, CommaCommand& command) {
-  command.m_command = 0;
-  command.m_value = 0;
-
-  if ((next >= 'A' && next <= 'Z') || (next >= 'a' && next <= 'z')) {
-    m_buffer[0] = next;
-    m_length = 1;
-  } else if (next >= '0' && next <= '9') {
-    if (m_length > 0 && m_length < 11) {
-      m_buffer[m_length++] = next;
-    } else {
+  command = CommaCommand();
+
+  SingleSink sink(command);
+  push_block(&next, 1, sink);
+
+  return (command.m_command != 0);
+}
+
+int Comma::push_block(const char *ptr, size_t length, Sink& sink) {
+  int count = 0;
+
+  const char *end = ptr + length;
+
+  while (ptr < end) {
+    char next = *ptr++;
+
+    if (s_is_letter(next)) {
+      m_command = next;
+      m_type = ct_Unsigned;
+      m_value = 0;
+      m_length = 1;
+      m_bDelta = false;
+      m_vector.clear();
+      continue;
+    }
+    if (m_length == 1 && m_type == ct_Unsigned && !m_bDelta) {
+      if (s_is_marker(next)) {
+	m_type = (next == '-') ? ct_Signed : ct_Float;
+	continue;
+      }
+      if (next == '~' && !m_vector.count()) {
+	m_bDelta = true;
+	continue;
+      }
+    }
+    if (m_bDelta && m_length) {
+      int d = s_radix32_digit(next);
+      if (d >= 0) {
+	if (m_length > s_radix32_max || (m_value >> (8 * sizeof(unsigned long) - 5))) // too many digits, or would overflow
+	  m_length = 0;
+	else {
+	  m_value = (m_value << 5) | d;
+	  ++m_length;
+	}
+	continue;
+      }
+      if (next == ',') {
+	CommaCommand C(m_command);
+	if (m_delta && m_delta->decode(C, m_value)) {
+	  sink.comma_received(C);
+	  ++count;
+	}
+      }
       m_length = 0;
+      continue;
+    }
+    if (s_is_digit(next)) {
+      const char *run = ptr - 1;
+      while (ptr < end && s_is_digit(*ptr)) // find the end of the run of digits
+	++ptr;
+
+      int digits = ptr - run;
+      if (!m_length || m_length + digits > 11) { // no command, or too many digits
+	m_length = 0;
+	continue;
+      }
+#ifdef COMMA_SWAR_DIGITS
+      if (digits >= 8) {
+	m_value = m_value * 100000000UL + s_swar_8_digits(run);
+	m_length += 8;
+	run += 8;
+      }
+#endif
+      while (run < ptr)
+	push_digit(*run++);
+      continue;
     }
-  } else if (m_length && next == ',') {
-    command.m_command = m_buffer[0];
-    if (m_length > 1) {
-      m_buffer[m_length] = 0;
-      if (sscanf(m_buffer + 1, "%lu", &command.m_value) != 1)
-	command.m_command = 0;
-      // command.m_value = strtoul(m_buffer+1, 0, 10);
+    if (m_length && (next == ',' || next == ':')) {
+      CommaCommand C(m_command, (m_type == ct_Signed) ? (0UL - m_value) : m_value);
+      C.m_type = m_type;
+
+      if (next == ':' || m_vector.count()) { // part of a vector
+	if (m_vector.push(C)) {
+	  if (next == ':') { // expect another value
+	    m_type = ct_Unsigned;
+	    m_value = 0;
+	    m_length = 1;
+	    continue;
+	  }
+	  m_vector.m_command = m_command;
+	  sink.comma_vector_received(m_vector);
+	  ++count;
+	}
+      } else {
+	if (m_delta)
+	  m_delta->update(C);
+	sink.comma_received(C);
+	++count;
+      }
     }
     m_length = 0;
-  } else {
-    m_length = 0;
   }
-  return (command.m_command != 0);
+  return count;
+}
+
+static inline bool s_put_byte(char *payload, int& length, char byte) {
+  if (length == Comma::FrameMax - 2) // leave room for the COBS code byte & the delimiter
+    return false;
+  payload[length++] = byte;
+  return true;
+}
+
+static bool s_put_varint(char *payload, int& length, unsigned long value) {
+  do {
+    unsigned char byte = value & 0x7F;
+    value >>= 7;
+    if (value)
+      byte |= 0x80;
+    if (!s_put_byte(payload, length, byte))
+      return false;
+  } while (value);
+  return true;
+}
+
+static bool s_get_varint(const char *payload, int length, int& i, unsigned long& value) {
+  value = 0;
+
+  int shift = 0;
+  while (true) {
+    if (i == length || shift >= 8 * (int) sizeof(unsigned long))
+      return false;
+    unsigned char byte = payload[i++];
+    value |= (unsigned long) (byte & 0x7F) << shift;
+    shift += 7;
+    if (!(byte & 0x80))
+      break;
+  }
+  return true;
+}
+
+static int s_cobs_encode(const char *payload, int length, char *frame, int max) {
+  if (length + 2 > max)
+    return 0;
+
+  /* COBS: each code byte gives the distance to the next zero (or to the end of the payload)
+   */
+  char *code = frame;
+  char *ptr = frame + 1;
+  unsigned char distance = 1;
+
+  for (int i = 0; i < length; i++) {
+    if (payload[i]) {
+      *ptr++ = payload[i];
+      ++distance;
+    } else {
+      *code = distance;
+      code = ptr++;
+      distance = 1;
+    }
+  }
+  *code = distance;
+  *ptr++ = 0;
+
+  return ptr - frame;
+}
+
+int Comma::encode_frame(const CommaCommand *commands, int count, char *frame, int max) {
+  char payload[FrameMax];
+  int length = 0;
+
+  for (int i = 0; i < count; i++) {
+    char marker = commands[i].marker();
+    if (marker)
+      if (!s_put_byte(payload, length, marker))
+	return 0;
+    if (!s_put_byte(payload, length, commands[i].m_command))
+      return 0;
+    if (!s_put_varint(payload, length, commands[i].magnitude()))
+      return 0;
+  }
+  return s_cobs_encode(payload, length, frame, max);
+}
+
+int Comma::encode_frame(const CommaVector& vector, char *frame, int max) {
+  char payload[FrameMax];
+  int length = 0;
+
+  if (!s_put_byte(payload, length, ':') || !s_put_byte(payload, length, vector.m_command))
+    return 0;
+  if (!s_put_varint(payload, length, vector.count()))
+    return 0;
+
+  for (int i = 0; i < vector.count(); i++) {
+    CommaCommand C = vector[i];
+    if (!s_put_byte(payload, length, C.marker()))
+      return 0;
+    if (!s_put_varint(payload, length, C.magnitude()))
+      return 0;
+  }
+  return s_cobs_encode(payload, length, frame, max);
+}
+
+int Comma::encode_text(const CommaCommand& command, char *buffer, int max) {
+  if (max < TextSingle)
+    return 0;
+
+  int length = 0;
+  buffer[length++] = command.m_command;
+
+  char marker = command.marker();
+  if (marker)
+    buffer[length++] = marker;
+
+  unsigned long value = command.magnitude();
+  if (value) // zero is sent without digits, e.g., a,
+    length += format_digits(value, buffer + length);
+
+  buffer[length++] = ',';
+  return length;
+}
+
+int Comma::encode_delta(char command, unsigned long delta, char *buffer, int max, bool bBinary) {
+  if (bBinary) {
+    char payload[FrameMax];
+    int length = 0;
+
+    s_put_byte(payload, length, '~');
+    s_put_byte(payload, length, command);
+    s_put_varint(payload, length, delta);
+
+    return s_cobs_encode(payload, length, buffer, max);
+  }
+
+  char digits[s_radix32_max];
+  int count = 0;
+  while (delta) {
+    digits[count++] = s_radix32[delta & 31];
+    delta >>= 5;
+  }
+  if (count + 3 > max)
+    return 0;
+
+  int length = 0;
+  buffer[length++] = command;
+  buffer[length++] = '~';
+  while (count)
+    buffer[length++] = digits[--count];
+  buffer[length++] = ',';
+
+  return length;
+}
+
+int Comma::decode_frame(Sink& sink) {
+  /* undo the COBS encoding in place
+   */
+  int length = 0;
+  int i = 0;
+
+  while (i < m_frame_length) {
+    unsigned char code = m_frame[i++];
+    if (!code || i + code - 1 > m_frame_length) // corrupt
+      return 0;
+    for (int j = 1; j < code; j++)
+      m_frame[length++] = m_frame[i++];
+    if (code < 0xFF && i < m_frame_length)
+      m_frame[length++] = 0;
+  }
+  if (length == 1 && m_frame[0] == ';')
+    return -1;
+
+  /* check the whole frame before delivering any of it
+   */
+  int count = 0;
+  for (int pass = 0; pass < 2; pass++) {
+    i = 0;
+    while (i < length) {
+      CommaCommand C(m_frame[i++]);
+
+      if (C.m_command == ':' && i < length) { // vector
+	m_vector.clear();
+	m_vector.m_command = m_frame[i++];
+	if (!s_is_letter(m_vector.m_command))
+	  return 0;
+
+	unsigned long n;
+	if (!s_get_varint(m_frame, length, i, n) || n > (unsigned long) CommaVector::Capacity)
+	  return 0;
+
+	while (n--) {
+	  char marker = (i < length) ? m_frame[i++] : 'x';
+	  if (marker && !s_is_marker(marker))
+	    return 0;
+	  C.m_type = !marker ? ct_Unsigned : ((marker == '-') ? ct_Signed : ct_Float);
+	  if (!s_get_varint(m_frame, length, i, C.m_value))
+	    return 0;
+	  if (C.m_type == ct_Signed)
+	    C.m_value = 0UL - C.m_value;
+	  m_vector.push(C);
+	}
+	if (pass) {
+	  sink.comma_vector_received(m_vector);
+	  ++count;
+	}
+	continue;
+      }
+
+      bool bDelta = (C.m_command == '~');
+      if ((bDelta || s_is_marker(C.m_command)) && i < length) {
+	C.m_type = (C.m_command == '-') ? ct_Signed : ((C.m_command == '.') ? ct_Float : ct_Unsigned);
+	C.m_command = m_frame[i++];
+      }
+      if (!s_is_letter(C.m_command))
+	return 0;
+      if (!s_get_varint(m_frame, length, i, C.m_value))
+	return 0;
+      if (C.m_type == ct_Signed)
+	C.m_value = 0UL - C.m_value;
+
+      if (pass) {
+	if (bDelta) {
+	  if (!m_delta || !m_delta->decode(C, C.m_value))
+	    continue;
+	} else if (m_delta)
+	  m_delta->update(C);
+	sink.comma_received(C);
+	++count;
+      }
+    }
+  }
+  m_vector.clear();
+  return count;
+}
+
+int Comma::push_binary(char next, Sink& sink) {
+  int count = 0;
+
+  if (next) {
+    if (m_frame_length >= 0) {
+      if (m_frame_length < FrameMax)
+	m_frame[m_frame_length++] = next;
+      else
+	m_frame_length = -1; // frame too long; discard
+    }
+  } else { // delimiter
+    if (m_frame_length > 0)
+      count = decode_frame(sink);
+    m_frame_length = 0;
+  }
+  return count;
 }
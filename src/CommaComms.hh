@@ -11,13 +11,22 @@
 
 namespace MultiShell {
 
+  enum CommaType
+    {
+     ct_Unsigned = 0, // e.g., a123,
+     ct_Signed,       // e.g., a-123, (non-negative values are sent as unsigned)
+     ct_Float         // e.g., a.1069547520, (IEEE-754 bits)
+    };
+
   class CommaCommand {
   public:
     char          m_command;
-    unsigned long m_value;
+    CommaType     m_type;
+    unsigned long m_value; // or two's complement, or IEEE-754 bits, according to type
 
     CommaCommand(char command = 0, unsigned long value = 0) :
       m_command(command),
+      m_type(ct_Unsigned),
       m_value(value)
     {
       // ...
@@ -25,31 +34,329 @@ namespace MultiShell {
     ~CommaCommand() {
       // ...
     }
+
+    inline CommaCommand& set_unsigned(unsigned long value) {
+      m_type = ct_Unsigned;
+      m_value = value;
+      return *this;
+    }
+    inline CommaCommand& set_signed(long value) {
+      m_type = ct_Signed;
+      m_value = (unsigned long) value;
+      return *this;
+    }
+    inline CommaCommand& set_float(float value);
+
+    inline unsigned long as_unsigned() const;
+    inline long as_signed() const;
+    inline float as_float() const;
+
+    inline char marker() const { // text & binary prefix for the value, if any
+      if (m_type == ct_Float)
+	return '.';
+      if (m_type == ct_Signed && (long) m_value < 0)
+	return '-';
+      return 0;
+    }
+    inline CommaType wire_type() const { // the type as received; non-negative signed values are sent as unsigned
+      return (m_type == ct_Signed && (long) m_value >= 0) ? ct_Unsigned : m_type;
+    }
+    inline unsigned long magnitude() const { // the value as transmitted after the marker
+      return (marker() == '-') ? (0UL - m_value) : m_value;
+    }
+
+    ShellBuffer& append(ShellBuffer& buffer) const { // always decimal, whatever the buffer's format
+      char digits[24];
+      digits[ShellBuffer::format_decimal(magnitude(), digits)] = 0;
+
+      char prefix[3] = { m_command, marker(), 0 };
+      buffer << prefix << digits << ',';
+      return buffer;
+    }
+  };
+
+  /* Several values under one letter, sent and received together, e.g., v12:-34:.1069547520:78,
+   */
+  class CommaVector {
+  public:
+    static const int Capacity = 8;
+
+    char m_command;
+  private:
+    uint8_t       m_count;
+    uint8_t       m_types[Capacity];
+    unsigned long m_values[Capacity];
+  public:
+    CommaVector(char command = 0) :
+      m_command(command),
+      m_count(0)
+    {
+      // ...
+    }
+    ~CommaVector() {
+      // ...
+    }
+
+    inline int count() const {
+      return m_count;
+    }
+    inline CommaVector& clear() {
+      m_count = 0;
+      return *this;
+    }
+    inline bool push(const CommaCommand& C) { // the command letter is ignored; returns false if full
+      if (m_count == Capacity)
+	return false;
+      m_types[m_count] = C.m_type;
+      m_values[m_count++] = C.m_value;
+      return true;
+    }
+    inline bool push_unsigned(unsigned long value) {
+      return push(CommaCommand(m_command).set_unsigned(value));
+    }
+    inline bool push_signed(long value) {
+      return push(CommaCommand(m_command).set_signed(value));
+    }
+    inline bool push_float(float value) {
+      return push(CommaCommand(m_command).set_float(value));
+    }
+    inline CommaCommand operator[](int index) const { // index must be in range
+      CommaCommand C(m_command, m_values[index]);
+      C.m_type = (CommaType) m_types[index];
+      return C;
+    }
+
     ShellBuffer& append(ShellBuffer& buffer) const {
-      buffer.printf("%c%lu,", m_command, m_value);
+      buffer.append(m_command);
+      for (int i = 0; i < m_count; i++) {
+	CommaCommand C = (*this)[i];
+	char digits[24];
+	digits[ShellBuffer::format_decimal(C.magnitude(), digits)] = 0;
+
+	char prefix[2] = { C.marker(), 0 };
+	buffer << prefix << digits << ((i + 1 < m_count) ? ':' : ',');
+      }
       return buffer;
     }
   };
 
+  /* Tables with an entry per command letter (see CommaDelta, CommaRouter): A-Z => 0-25; a-z => 26-51;
+   * otherwise -1
+   */
+  static const int CommaLetters = 52;
+
+  inline int comma_letter_index(char command) {
+    if (command >= 'A' && command <= 'Z')
+      return command - 'A';
+    if (command >= 'a' && command <= 'z')
+      return 26 + command - 'a';
+    return -1;
+  }
+
+  /* Compact CommaComms: values for enabled letters are sent as the signed difference from the
+   * previous value for that letter, zigzag-coded, after a '~' marker - in text as base-32 digits
+   * "0123456789!#$%&()*+/<=>?@[]^_{|}" (no letters, so no clash with command letters), e.g., a~3,
+   * - or as a varint in binary frames. A delta carries the type of the value it modifies, so values
+   * that change sign are sent in full (see CommaCommand::wire_type()).
+   *
+   * One CommaDelta is needed per direction; any full value (re)sets the base for its letter, and
+   * resync() forces full values, e.g., after a disconnect or if deltas may have been lost.
+   */
+  class CommaDelta {
+  public:
+    static const int Letters = CommaLetters;
+
+    static inline int index(char command) {
+      return comma_letter_index(command);
+    }
+  private:
+    static const uint8_t f_Compact = 0x80; // sending: this letter is sent compactly
+    static const uint8_t f_Valid   = 0x40; // m_last[] holds the base for this letter
+    static const uint8_t f_Type    = 0x03;
+
+    unsigned long m_last[Letters];
+    uint8_t       m_flags[Letters];
+    unsigned long m_missed;
+  public:
+    CommaDelta() : m_missed(0) {
+      for (int i = 0; i < Letters; i++) {
+	m_last[i] = 0;
+	m_flags[i] = 0;
+      }
+    }
+    ~CommaDelta() {
+      // ...
+    }
+
+    inline void set_compact(char command, bool bCompact = true) { // sending only; opt-in per letter
+      int i = index(command);
+      if (i >= 0)
+	m_flags[i] = bCompact ? (m_flags[i] | f_Compact) : 0;
+    }
+    inline bool compact(char command) const {
+      int i = index(command);
+      return (i >= 0) && (m_flags[i] & f_Compact);
+    }
+    inline void resync() { // forget all bases, so that the next value for each letter is sent in full
+      for (int i = 0; i < Letters; i++)
+	m_flags[i] &= f_Compact;
+    }
+    inline unsigned long missed() const { // receiving: deltas dropped for lack of a base
+      return m_missed;
+    }
+
+    /* Sending: returns true, with the zigzag-coded difference, if the command can be sent as a delta;
+     * either way, the command becomes the new base.
+     */
+    bool encode(const CommaCommand& command, unsigned long& delta);
+
+    /* Receiving: apply a delta to the base for command.m_command; returns false if there is no base.
+     */
+    bool decode(CommaCommand& command, unsigned long delta);
+
+    inline void update(const CommaCommand& command) { // receiving: a full value
+      int i = index(command.m_command);
+      if (i >= 0) {
+	m_last[i] = command.m_value;
+	m_flags[i] = (m_flags[i] & f_Compact) | f_Valid | command.m_type;
+      }
+    }
+  };
+
   class Comma {
   public:
-    static float unpack754_32(uint32_t i);
-    static uint32_t pack754_32(float f);
+    /* IEEE-754 single precision, by bit reinterpretation
+     */
+    static inline float unpack754_32(uint32_t i) {
+      float f;
+      memcpy(&f, &i, 4);
+      return f;
+    }
+    static inline uint32_t pack754_32(float f) {
+      uint32_t i;
+      memcpy(&i, &f, 4);
+      return i;
+    }
+
+    /* Binary CommaComms: COBS-encoded frames, each terminated by a zero byte, containing one or more
+     * commands as a letter followed by an unsigned LEB128 varint value (the letter is preceded by the
+     * marker, if any - see CommaCommand::marker()); a vector is ':', the letter, the count, and then
+     * each value as its marker (or 0) and varint. A frame containing only ';' requests a return to
+     * text mode. A compact delta is '~', the letter, and the zigzag-coded difference (see CommaDelta).
+     */
+    static const int FrameMax    = 64;                                          // max. frame length, including delimiter
+    static const int FrameSingle = 4 + (8 * (int) sizeof(unsigned long) + 6) / 7; // max. frame length for a single command
+
+    static int encode_frame(const CommaCommand *commands, int count, char *frame, int max); // returns frame length, or 0 if too long
+    static int encode_frame(const CommaVector& vector, char *frame, int max);
+
+    static const int TextSingle = 3 + (5 * (int) sizeof(unsigned long) + 1) / 2; // max. text length of a single command, e.g., a-123,
 
+    static inline int format_digits(unsigned long value, char *buffer) { // decimal, two digits per step; returns digit count
+      return ShellBuffer::format_decimal(value, buffer);
+    }
+    static int encode_text(const CommaCommand& command, char *buffer, int max); // returns length, or 0 if too long
+
+    static const int DeltaText = 3 + (8 * (int) sizeof(unsigned long) + 4) / 5; // max. text length of a delta, e.g., a~3,
+
+    static int encode_delta(char command, unsigned long delta, char *buffer, int max, bool bBinary); // returns length, or 0
+
+    class Sink {
+    public:
+      virtual void comma_received(CommaCommand& command) = 0;
+      virtual void comma_vector_received(CommaVector& vector) { }
+
+      virtual ~Sink() { }
+    };
   private:
-    int  m_length;
-    char m_buffer[16]; // command receive buffer
+    int           m_length;  // number of characters received, including the command letter; 0 if none
+    char          m_command; // command receive state
+    CommaType     m_type;
+    unsigned long m_value;
+    CommaVector   m_vector;  // values received so far, if a vector
+    CommaDelta   *m_delta;   // compact receive state, if any
+    bool          m_bDelta;  // the value is a delta
+
+    int           m_frame_length; // binary frame receive buffer; -1 if discarding until the next delimiter
+    char          m_frame[FrameMax];
+
+    int decode_frame(Sink& sink);
+
+    inline void push_digit(char digit) { // append a digit to the value; saturates like strtoul()
+      unsigned long d = digit - '0';
+      if (sizeof(unsigned long) == 4 && m_length == 10) { // only a 10th digit can overflow 32 bits
+	if (m_value > 429496729UL || (m_value == 429496729UL && d > 5)) {
+	  m_value = ~0UL;
+	  ++m_length;
+	  return;
+	}
+      }
+      m_value = m_value * 10 + d;
+      ++m_length;
+    }
   public:
-    Comma() : m_length(0) {
+    Comma() : m_length(0), m_command(0), m_type(ct_Unsigned), m_value(0), m_delta(0), m_bDelta(false), m_frame_length(0) {
       // ...
     }
     ~Comma() {
       // ...
     }
 
-    bool push(char c, CommaCommand& C); // returns true & updates C if a command is received
+    bool push(char c, CommaCommand& C); // returns true & updates C if a command is received; vectors are dropped
+
+    /* Decode a whole span, passing every complete command or vector to the sink; state carries over
+     * between calls, and the accept/reject behaviour is identical to calling push() for each character.
+     */
+    int push_block(const char *ptr, size_t length, Sink& sink); // returns the number of commands received
+
+    inline int push(char c, Sink& sink) {
+      return push_block(&c, 1, sink);
+    }
+
+    /* Binary mode: returns the number of commands received when a frame completes, or -1 if the frame
+     * requests a return to text mode.
+     */
+    int push_binary(char c, Sink& sink);
+
+    inline void clear() {
+      m_length = 0;
+      m_frame_length = 0;
+    }
+
+    inline void set_delta(CommaDelta *state) { // enables compact (delta) commands; these are dropped otherwise
+      m_delta = state;
+    }
+    inline void resync() {
+      if (m_delta)
+	m_delta->resync();
+    }
   };
 
+  inline CommaCommand& CommaCommand::set_float(float value) {
+    m_type = ct_Float;
+    m_value = Comma::pack754_32(value);
+    return *this;
+  }
+  inline unsigned long CommaCommand::as_unsigned() const {
+    if (m_type == ct_Float) {
+      float f = Comma::unpack754_32(m_value);
+      return (f > 0) ? (unsigned long) f : 0;
+    }
+    return m_value;
+  }
+  inline long CommaCommand::as_signed() const {
+    if (m_type == ct_Float)
+      return (long) Comma::unpack754_32(m_value);
+    return (long) m_value;
+  }
+  inline float CommaCommand::as_float() const {
+    if (m_type == ct_Float)
+      return Comma::unpack754_32(m_value);
+    if (m_type == ct_Signed)
+      return (float) (long) m_value;
+    return (float) m_value;
+  }
+
 } // MultiShell
 
 #endif /* !cariot_CommaComms_hh */
@@ -0,0 +1,122 @@
+/* -*- mode: c++ -*-
+ * 
+ * Copyright 2022 Francis James Franklin
+ * 
+ * Open Source under the MIT License - see LICENSE in the project's root folder
+ */
+
+#include "Shell.hh"
+#include "CommaRouter.hh"
+
+using namespace MultiShell;
+
+bool CommaRoute::accepts(const CommaCommand& command) const {
+  if (!m_bRange)
+    return true;
+
+  switch (command.m_type) {
+  case ct_Float:
+    {
+      float f = command.as_float();
+      return (f >= (float) m_min) && (f <= (float) m_max);
+    }
+  case ct_Signed:
+    {
+      long l = command.as_signed();
+      return (l >= m_min) && (l <= m_max);
+    }
+  default:
+    break;
+  }
+  if (m_max < 0) // no unsigned value can be in range
+    return false;
+
+  unsigned long u = command.as_unsigned();
+  return (m_min <= 0 || u >= (unsigned long) m_min) && (u <= (unsigned long) m_max);
+}
+
+void CommaRoute::route(Shell& origin, CommaCommand& command) const {
+  if (m_handler)
+    m_handler->comma_command(origin, command);
+  else if (m_callback)
+    m_callback(m_context, origin, command);
+}
+
+void CommaRoute::route(Shell& origin, CommaVector& vector) const {
+  if (m_handler)
+    m_handler->comma_vector(origin, vector);
+}
+
+CommaRouter::CommaRouter(ShellHandler *fallback) :
+  m_fallback(fallback),
+  m_rejected(0)
+{
+  for (int i = 0; i < TableSize; i++)
+    m_table[i] = 0;
+}
+
+CommaRouter::CommaRouter(const CommaRoute *routes, int count, ShellHandler *fallback) :
+  m_fallback(fallback),
+  m_rejected(0)
+{
+  for (int i = 0; i < TableSize; i++)
+    m_table[i] = 0;
+  for (int r = 0; r < count; r++)
+    add(routes + r);
+}
+
+CommaRouter::~CommaRouter() {
+  // ...
+}
+
+bool CommaRouter::add(const CommaRoute *route) {
+  int i = route ? index(route->command()) : -1;
+  if (i < 0)
+    return false;
+  m_table[i] = route;
+  return true;
+}
+
+void CommaRouter::shell_notification(Shell& origin, const char *message) {
+  if (m_fallback)
+    m_fallback->shell_notification(origin, message);
+}
+
+void CommaRouter::comma_command(Shell& origin, CommaCommand& command) {
+  const CommaRoute *R = route(command.m_command);
+  if (!R) {
+    if (m_fallback)
+      m_fallback->comma_command(origin, command);
+  } else if (!R->accepts(command)) {
+    ++m_rejected;
+  } else {
+    R->route(origin, command);
+  }
+}
+
+void CommaRouter::comma_vector(Shell& origin, CommaVector& vector) {
+  const CommaRoute *R = route(vector.m_command);
+  if (!R) {
+    if (m_fallback)
+      m_fallback->comma_vector(origin, vector);
+    return;
+  }
+  for (int i = 0; i < vector.count(); i++)
+    if (!R->accepts(vector[i])) {
+      ++m_rejected;
+      return;
+    }
+  R->route(origin, vector);
+}
+
+CommandError CommaRouter::shell_command(Shell& origin, Args& args) {
+  if (m_fallback)
+    return m_fallback->shell_command(origin, args);
+  return ce_UnhandledCommand;
+}
+
+CommandError CommaRouter::resume_command(Shell& origin, PendingState& state) {
+  if (m_fallback)
+    return m_fallback->resume_command(origin, state);
+  return ce_OtherError;
+}
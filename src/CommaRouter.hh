@@ -0,0 +1,123 @@
+/* -*- mode: c++ -*-
+ * 
+ * Copyright 2022 Francis James Franklin
+ * 
+ * Open Source under the MIT License - see LICENSE in the project's root folder
+ */
+
+#ifndef __CommaRouter_hh__
+#define __CommaRouter_hh__
+
+#include <ShellUtils.hh>
+#include <CommaComms.hh>
+#include <ShellCommand.hh>
+
+namespace MultiShell {
+
+  /* Where commands for one letter should go: either a ShellHandler (commands & vectors), or a
+   * callback (commands only), optionally with a range check on the value; routes can be const.
+   */
+  class CommaRoute {
+  public:
+    typedef void (*Callback)(void *context, Shell& origin, CommaCommand& command);
+  private:
+    char          m_command;
+    bool          m_bRange;
+    long          m_min;
+    long          m_max;
+    ShellHandler *m_handler;
+    Callback      m_callback;
+    void         *m_context;
+
+    template<class T, void (T::*M)(Shell&, CommaCommand&)> static void member_callback(void *context, Shell& origin, CommaCommand& command) {
+      (((T *) context)->*M)(origin, command);
+    }
+  public:
+    constexpr CommaRoute(char command, ShellHandler& handler) :
+      m_command(command), m_bRange(false), m_min(0), m_max(0), m_handler(&handler), m_callback(0), m_context(0)
+    {
+      // ...
+    }
+    constexpr CommaRoute(char command, ShellHandler& handler, long min, long max) :
+      m_command(command), m_bRange(true), m_min(min), m_max(max), m_handler(&handler), m_callback(0), m_context(0)
+    {
+      // ...
+    }
+    constexpr CommaRoute(char command, Callback callback, void *context = 0) :
+      m_command(command), m_bRange(false), m_min(0), m_max(0), m_handler(0), m_callback(callback), m_context(context)
+    {
+      // ...
+    }
+    constexpr CommaRoute(char command, Callback callback, void *context, long min, long max) :
+      m_command(command), m_bRange(true), m_min(min), m_max(max), m_handler(0), m_callback(callback), m_context(context)
+    {
+      // ...
+    }
+
+    /* e.g., CommaRoute r = CommaRoute::member<Claw, &Claw::set_speed>('f', claw, -127, 127);
+     */
+    template<class T, void (T::*M)(Shell&, CommaCommand&)> static CommaRoute member(char command, T& object) {
+      return CommaRoute(command, member_callback<T, M>, &object);
+    }
+    template<class T, void (T::*M)(Shell&, CommaCommand&)> static CommaRoute member(char command, T& object, long min, long max) {
+      return CommaRoute(command, member_callback<T, M>, &object, min, max);
+    }
+
+    inline char command() const {
+      return m_command;
+    }
+    bool accepts(const CommaCommand& command) const; // value within range, if a range is set
+
+    void route(Shell& origin, CommaCommand& command) const;
+    void route(Shell& origin, CommaVector& vector) const;
+  };
+
+  /* Set as a Shell's handler: routes CommaComms in constant time by letter; commands for letters
+   * without a route, and shell notifications & commands, go to the fallback handler, if any. The routes
+   * themselves aren't copied, and must outlive the router.
+   */
+  class CommaRouter : public ShellHandler {
+  public:
+    static const int TableSize = CommaLetters;
+
+    static inline int index(char command) {
+      return comma_letter_index(command);
+    }
+  private:
+    const CommaRoute *m_table[TableSize];
+    ShellHandler     *m_fallback;
+    unsigned long     m_rejected;
+  public:
+    CommaRouter(ShellHandler *fallback = 0);
+    CommaRouter(const CommaRoute *routes, int count, ShellHandler *fallback = 0);
+
+    virtual ~CommaRouter();
+
+    /* Replaces any existing route; returns false if not a letter. The router keeps the pointer, so the
+     * route must outlive it, e.g., a static, const table or a member of the same object - not a temporary.
+     */
+    bool add(const CommaRoute *route);
+
+    inline void remove(char command) {
+      int i = index(command);
+      if (i >= 0)
+	m_table[i] = 0;
+    }
+    inline const CommaRoute *route(char command) const {
+      int i = index(command);
+      return (i >= 0) ? m_table[i] : 0;
+    }
+    inline unsigned long rejected() const { // number of commands & vectors dropped by range checks
+      return m_rejected;
+    }
+
+    virtual void shell_notification(Shell& origin, const char *message);
+    virtual void comma_command(Shell& origin, CommaCommand& command);
+    virtual void comma_vector(Shell& origin, CommaVector& vector);
+    virtual CommandError shell_command(Shell& origin, Args& args);
+    virtual CommandError resume_command(Shell& origin, PendingState& state);
+  };
+
+} // MultiShell
+
+#endif /* !__CommaRouter_hh__ */
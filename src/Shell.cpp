@@ -13,63 +13,133 @@ using namespace MultiShell;
 
 Repository Shell::m_repository;
 
+void MultiShell::MULTISHELL_CONFIG() { // see ShellConfig.hh
+  // ...
+}
+
 Shell::~Shell() {
   // ...
 }
 
+void Shell::set_binary(bool bBinary) {
+  set_binary_mode(bBinary);
+  m_stream->set_raw(bBinary);
+  m_comma.clear();
+
+  if (m_state == is_CC || m_state == is_Binary)
+    reset();
+}
+
+void Shell::comma_received(CommaCommand& command) {
+  if (m_handler)
+    m_handler->comma_command(*this, command);
+}
+
+void Shell::comma_vector_received(CommaVector& vector) {
+  if (m_handler)
+    m_handler->comma_vector(*this, vector);
+}
+
+void Shell::command_result(CommandError ce, ShellHandler *handler) {
+  if (ce == ce_Pending) {
+    m_pending = handler;
+    return;
+  }
+  m_pending = 0;
+
+  if (ce == ce_IncorrectUsage) {
+    *this << "Error! Incorrect usage. Try 'help'." << 0;
+  }
+  if (ce == ce_UnhandledCommand) {
+    *this << "Error! (Internal: No handler)." << 0;
+  }
+}
+
 void Shell::update() {
   m_stream->update(); // housekeeping for in & out
 
+  if (m_pending) { // resume the command in progress, even if disconnected
+    command_result(m_pending->resume_command(*this, m_pending_state), m_pending);
+  }
+
   if (!*m_stream) { // no active serial connection
+    if (binary_mode())
+      set_binary(false);
+    m_comma.resync();
+    resync();
     reset();
+    m_inptr = m_inend = m_input; // discard unparsed input
+    m_manager.disconnected();    // and queued output, depending on the policy
     return;
   }
 
   /* data-out processing
    */
   m_manager.process_tasks(*m_stream);
+  check_capacity(); // notify the waiter, if any, once pools that ran dry have recovered
 
-  /* the rest is data-in processing
+  /* the rest is data-in processing: every complete command (or CommaComms block) in the available
+   * input, switching modes as they come, unless limited by the command budget
    */
   int count = m_stream->sync_read_begin();
 
-  if (m_state == is_CC) { // CommaComms input mode
-    CommaCommand C;
-    while (count) {
-      int ic = m_stream->read(count);
-      if (ic < 0)
-	break;
-
-      char c = ic;
-
-      if (c == ';') {
-	if (m_comma.push(',', C))
-	  if (m_handler)
-	    m_handler->comma_command(*this, C);
-	reset(is_Start);
-	break;
+  for (int commands = 0; !m_command_budget || commands < m_command_budget; commands++) {
+    if (m_pending) { // input waits until the command completes
+      return;
+    }
+    if (m_state == is_Binary) { // binary CommaComms input mode
+      while (input_ready(count)) {
+	if (m_comma.push_binary(*m_inptr++, *this) < 0) { // back to text, and shell input
+	  set_binary(false);
+	  reset(is_Start);
+	  break;
+	}
       }
-      if (m_comma.push(c, C))
-	if (m_handler)
-	  m_handler->comma_command(*this, C);
+      if (m_state == is_Binary) { // (still) binary CommaComms input mode
+	return;
+      }
+      continue;
     }
-    if (m_state == is_CC) { // (still) CommaComms input mode
-      return;
+
+    if (m_state == is_CC) { // CommaComms input mode
+      while (input_ready(count)) {
+	const char *semicolon = (const char *) memchr(m_inptr, ';', m_inend - m_inptr);
+	const char *span_end = semicolon ? semicolon : m_inend;
+
+	m_stream->control_bytes(m_inptr, span_end - m_inptr);
+	m_comma.push_block(m_inptr, span_end - m_inptr, *this);
+	m_inptr = span_end;
+
+	if (semicolon) {
+	  ++m_inptr;
+	  m_comma.push(',', *this);
+	  reset(is_Start);
+	  break;
+	}
+      }
+      if (m_state == is_CC) { // (still) CommaComms input mode
+	return;
+      }
+      continue;
     }
+
+    if (!parse_text(count)) // input used up
+      return;
   }
+}
 
+/* Shell input, up to and including the end of a command; returns false if the input was used up first
+ */
+bool Shell::parse_text(int& count) {
   char *ptr = m_buffer + m_index;
 
-  while (count) {
-    int ic = m_stream->read(count);
-    if (ic < 0)
-      break;
-
-    char c = ic;
+  while (input_ready(count)) {
+    char c = *m_inptr++;
+    m_stream->control_byte(c); // reported here, not on read, so that binary frames never trigger it
     if (c == 4) {
       if (m_handler)
 	m_handler->shell_notification(*this, "end");
-      break;
+      return true;
     }
 
     bool bEOL = (c == '\n') || (c == '\r') || ((m_state != is_String) && ((c == ',') || (c == ';')));
@@ -79,7 +149,7 @@ void Shell::update() {
     if (m_state == is_Discard) {
       if (bEOL) {
         reset((c == ';') ? is_Start : is_CC);
-	break;
+	return true;
       }
       continue;
     }
@@ -114,19 +184,15 @@ void Shell::update() {
           if (!handler)
             *this << "Error! (Internal: No default handler set)." << 0;
           else {
-            CommandError ce = handler->shell_command(*this, args);
-
-            if (ce == ce_IncorrectUsage) {
-              *this << "Error! Incorrect usage. Try 'help'." << 0;
-            }
-            if (ce == ce_UnhandledCommand) {
-              *this << "Error! (Internal: No handler)." << 0;
-            }
+            m_pending_state.m_since = millis();
+            m_pending_state.m_value = 0;
+            m_pending_state.m_data  = 0;
+            command_result(handler->shell_command(*this, args), handler);
           }
         }
       }
       reset((c == ';') ? is_Start : is_CC);
-      break;
+      return true;
     }
     if (bWS) {
       if (m_state == is_Start)
@@ -153,7 +219,7 @@ void Shell::update() {
       }
     }
 
-    if (m_index == BufferSize - 1) {
+    if (m_index >= m_buffer_size - 1) {
       *this << "Error! Command too long." << 0;
       m_state = is_Discard; // reset
       m_index = 0;
@@ -167,4 +233,5 @@ void Shell::update() {
     if (m_state == is_Start)
       m_state = is_Processing;
   }
+  return false;
 }
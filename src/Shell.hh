@@ -13,17 +13,18 @@
 #include <ShellStream.hh>
 #include <ShellBuffer.hh>
 #include <ShellCommand.hh>
+#include <CommaRouter.hh>
 #include <ShellOption.hh>
 #include <ShellTask.hh>
 #include <ShellPlot.hh>
 
 namespace MultiShell {
 
-  class Shell : public Dispatcher {
+  class Shell : public Dispatcher, private Comma::Sink {
   private:
     static Repository  m_repository;
 
-    static const int  BufferSize = 64;
+    static const int  InputSpan  = 32; // bytes read from the stream at a time
 
     TaskOwner<Task>  m_manager;
 
@@ -31,14 +32,22 @@ namespace MultiShell {
     Comma         m_comma;
     ShellStream  *m_stream;
     ShellHandler *m_handler;
+    ShellHandler *m_pending; // handler of a command still in progress, if any
+    PendingState  m_pending_state;
     InputState    m_state;
 
+    int   m_command_budget; // maximum commands per update(), or 0 for no limit
     int   m_index;
-    char  m_buffer[BufferSize];
+    char *m_buffer;     // command line, e.g., a SizedShell's
+    int   m_buffer_size;
     char  m_name[3];
 
+    const char *m_inptr; // input read from the stream, but not yet parsed
+    const char *m_inend;
+    char  m_input[InputSpan];
+
     inline void reset(InputState is = is_CC) {
-      m_state = is;
+      m_state = (is == is_CC && binary_mode()) ? is_Binary : is;
       m_index = 0;
     }
     inline void set_name(char identifier) {
@@ -50,7 +59,12 @@ namespace MultiShell {
     static inline void repository_status(ShellBuffer& buffer) {
       m_repository.status(buffer);
     }
-    static inline ShellBuffer *tmp_buffer() { // get a temporary 128-byte buffer
+    static inline void repository_usage(ShellBuffer& buffer, bool bReset = false) {
+      m_repository.usage(buffer);
+      if (bReset)
+	m_repository.reset_usage();
+    }
+    static inline ShellBuffer *tmp_buffer() { // get a temporary buffer (128 bytes, unless reconfigured)
       return m_repository.tmp_buffer();
     }
 
@@ -58,17 +72,33 @@ namespace MultiShell {
       return m_name;
     }
 
-    Shell(ShellStream& stream, CommandList& list, char id) :
+    Shell(ShellStream& stream, CommandList& list, char id, char *buffer, int size) : // the command-line buffer is the caller's; see SizedShell
       m_command_list(&list),
       m_stream(&stream),
-      m_handler(0)
+      m_handler(0),
+      m_pending(0),
+      m_pending_state(),
+      m_command_budget(0),
+      m_buffer(buffer),
+      m_buffer_size(size),
+      m_inptr(m_input),
+      m_inend(m_input)
     {
+      config_check();
       reset();
       set_name(id);
       init(m_manager, m_repository);
     }
+    /* Shell(stream, list, id), which had a 64-byte buffer of its own, is now SizedShell<>(stream, list, id)
+     */
+    Shell(ShellStream& stream, CommandList& list, char id) = delete;
+
     virtual ~Shell();
 
+    inline int command_buffer_size() const { // the longest command line is one less
+      return m_buffer_size;
+    }
+
     inline void set_handler(ShellHandler *handler) {
       m_handler = handler;
     }
@@ -78,8 +108,70 @@ namespace MultiShell {
       m_manager.respond_to_RSVP();
     }
 
+    /* Switch CommaComms between text (default) and binary frames, both in and out; the stream reverts
+     * to text if disconnected, or if the host sends a frame containing just ';'
+     */
+    void set_binary(bool bBinary);
+
+    /* Compact CommaComms (see CommaDelta): deltas are accepted if there is a receive state, and letters
+     * enabled in the send state are sent as deltas; both are resynced if disconnected.
+     */
+    inline void set_delta_states(CommaDelta *receive, CommaDelta *send) {
+      m_comma.set_delta(receive);
+      set_compact_state(send);
+    }
+
+    /* update() processes every complete command in the input available, unless limited by the budget,
+     * so that pipelined commands aren't held to one per update
+     */
+    inline void set_command_budget(int commands) { // 0 for no limit
+      m_command_budget = (commands < 0) ? 0 : commands;
+    }
+    inline int command_budget() const {
+      return m_command_budget;
+    }
+
+    inline bool command_pending() const { // an asynchronous command is in progress
+      return m_pending;
+    }
+    inline PendingState& pending() { // this shell's state of the command in progress (or starting)
+      return m_pending_state;
+    }
+
     void update();
+  private:
+    bool parse_text(int& count);
+    void command_result(CommandError ce, ShellHandler *handler);
+
+    inline bool input_ready(int& count) { // refills the input span from the stream, if empty
+      if (m_inptr < m_inend)
+	return true;
+      int length = m_stream->read(m_input, (count < InputSpan) ? count : InputSpan);
+      count -= length;
+      m_inptr = m_input;
+      m_inend = m_input + length;
+      return length > 0;
+    }
+
+    virtual void comma_received(CommaCommand& command); // Comma::Sink
+    virtual void comma_vector_received(CommaVector& vector);
   };
+  /* A Shell with its own command-line buffer of Size bytes: SizedShell<> for the default (64, or
+   * MULTISHELL_COMMAND_BUFSIZE), or e.g. SizedShell<256> for long pipelined configuration scripts, or
+   * SizedShell<32> to save memory
+   */
+  template<int Size = MULTISHELL_COMMAND_BUFSIZE> class SizedShell : public Shell {
+  private:
+    char m_sized_line[Size];
+  public:
+    SizedShell(ShellStream& stream, CommandList& list, char id) :
+      Shell(stream, list, id, m_sized_line, Size)
+    {
+      // ...
+    }
+    virtual ~SizedShell() { }
+  };
+
   inline Dispatcher& operator<<(Dispatcher& lhs, const Args& args) {
     lhs.dispatch_buffer(args.c_str(), strlen(args.c_str()));
     return lhs;
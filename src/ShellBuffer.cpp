@@ -22,3 +22,302 @@ void ShellBuffer::init() {
   dtostrf(1.0f, 1, 2, m_tmp);
 #endif
 }
+
+static const char s_digit_pairs[] = // "00" to "99"
+  "0001020304050607080910111213141516171819"
+  "2021222324252627282930313233343536373839"
+  "4041424344454647484950515253545556575859"
+  "6061626364656667686970717273747576777879"
+  "8081828384858687888990919293949596979899";
+
+int ShellBuffer::format_decimal(unsigned long value, char *buffer) {
+  char digits[24];
+  char *ptr = digits + sizeof(digits);
+
+  while (value >= 100) {
+    unsigned long q = value / 100;
+    const char *pair = s_digit_pairs + 2 * (value - q * 100);
+    *--ptr = pair[1];
+    *--ptr = pair[0];
+    value = q;
+  }
+  if (value >= 10) {
+    const char *pair = s_digit_pairs + 2 * value;
+    *--ptr = pair[1];
+    *--ptr = pair[0];
+  } else {
+    *--ptr = '0' + value;
+  }
+
+  int count = digits + sizeof(digits) - ptr;
+  memcpy(buffer, ptr, count);
+  return count;
+}
+
+void ShellBuffer::pad(int length, bool bNegative, bool bZero) {
+  int padding = m_width - length;
+  m_width = 0; // one value only
+
+  if (!bZero)
+    while (padding-- > 0)
+      append(' ');
+  if (bNegative)
+    append('-');
+  if (bZero)
+    while (padding-- > 0)
+      append('0');
+}
+
+ShellBuffer& ShellBuffer::append_unsigned(unsigned long value) {
+  char digits[24];
+  int count = 0;
+
+  if (m_base == sb_Decimal)
+    count = format_decimal(value, digits);
+  else {
+    const char *hex = (m_base == sb_HexUpper) ? "0123456789ABCDEF" : "0123456789abcdef";
+    char *ptr = digits + sizeof(digits);
+    do {
+      *--ptr = hex[value & 0xF];
+      value >>= 4;
+    } while (value);
+    count = digits + sizeof(digits) - ptr;
+    memmove(digits, ptr, count);
+  }
+  pad(count, false, m_fill == '0');
+
+  for (int i = 0; i < count; i++)
+    append(digits[i]);
+  return *this;
+}
+
+ShellBuffer& ShellBuffer::append_signed(long value, unsigned long bits) {
+  if (m_base != sb_Decimal)
+    return append_unsigned(bits);
+  if (value >= 0)
+    return append_unsigned((unsigned long) value);
+
+  char digits[24];
+  int count = format_decimal(0UL - (unsigned long) value, digits);
+
+  pad(count + 1, true, m_fill == '0');
+
+  for (int i = 0; i < count; i++)
+    append(digits[i]);
+  return *this;
+}
+
+namespace {
+  /* A non-negative integer as 32-bit limbs, least significant first, with just enough arithmetic to
+   * convert a double exactly to fixed point; the caller provides the storage
+   */
+  class Limbs {
+  public:
+    uint32_t *m_limb;
+    int       m_count;
+
+    Limbs(uint32_t *limb, uint64_t value) : m_limb(limb), m_count(0) {
+      while (value) {
+	m_limb[m_count++] = (uint32_t) value;
+	value >>= 32;
+      }
+    }
+    ~Limbs() {
+      // ...
+    }
+    inline bool is_zero() const {
+      return !m_count;
+    }
+    inline bool bit(int i) const {
+      int w = i / 32;
+      return (w < m_count) && ((m_limb[w] >> (i % 32)) & 1);
+    }
+    bool any_below(int i) const { // true if any bit below bit i is set
+      int w = i / 32;
+      for (int j = 0; j < w && j < m_count; j++)
+	if (m_limb[j])
+	  return true;
+      return (w < m_count) && (m_limb[w] & ((((uint32_t) 1) << (i % 32)) - 1));
+    }
+    inline void trim() {
+      while (m_count && !m_limb[m_count-1])
+	--m_count;
+    }
+    void mul(uint32_t f) {
+      uint64_t carry = 0;
+      for (int i = 0; i < m_count; i++) {
+	uint64_t v = (uint64_t) m_limb[i] * f + carry;
+	m_limb[i] = (uint32_t) v;
+	carry = v >> 32;
+      }
+      if (carry)
+	m_limb[m_count++] = (uint32_t) carry;
+    }
+    void shl(int bits) {
+      if (!m_count)
+	return;
+      int words = bits / 32;
+      bits %= 32;
+      if (bits) {
+	uint32_t carry = 0;
+	for (int i = 0; i < m_count; i++) {
+	  uint32_t v = m_limb[i];
+	  m_limb[i] = (v << bits) | carry;
+	  carry = v >> (32 - bits);
+	}
+	if (carry)
+	  m_limb[m_count++] = carry;
+      }
+      if (words) {
+	memmove(m_limb + words, m_limb, m_count * sizeof(uint32_t));
+	memset(m_limb, 0, words * sizeof(uint32_t));
+	m_count += words;
+      }
+    }
+    void shr(int bits) {
+      int words = bits / 32;
+      bits %= 32;
+      if (words >= m_count) {
+	m_count = 0;
+	return;
+      }
+      if (words) {
+	memmove(m_limb, m_limb + words, (m_count - words) * sizeof(uint32_t));
+	m_count -= words;
+      }
+      if (bits)
+	for (int i = 0; i < m_count; i++)
+	  m_limb[i] = (m_limb[i] >> bits) | ((i + 1 < m_count) ? (m_limb[i+1] << (32 - bits)) : 0);
+      trim();
+    }
+    void increment() {
+      for (int i = 0; i < m_count; i++)
+	if (++m_limb[i])
+	  return;
+      m_limb[m_count++] = 1;
+    }
+    uint32_t div(uint32_t d) { // returns the remainder
+      uint64_t r = 0;
+      for (int i = m_count; i-- > 0; ) {
+	uint64_t v = (r << 32) | m_limb[i];
+	m_limb[i] = (uint32_t) (v / d);
+	r = v % d;
+      }
+      trim();
+      return (uint32_t) r;
+    }
+  };
+}
+
+static void s_append_digits(ShellBuffer& buffer, const char *digits, int count, int& position, int point) {
+  while (count--) {
+    if (position++ == point)
+      buffer.append('.');
+    buffer.append(*digits++);
+  }
+}
+
+ShellBuffer& ShellBuffer::append_fixed(double value) {
+  static_assert(sizeof(double) == 8 || sizeof(double) == 4, "ShellBuffer: double must be IEEE 754 binary64 or binary32");
+
+  /* sign, biased exponent and mantissa of a 64-bit double, or of a 32-bit double (e.g., AVR)
+   */
+  const int mantissa_bits = (sizeof(double) == 8) ? 52 : 23;
+  const int exponent_max  = (sizeof(double) == 8) ? 0x7FF : 0xFF;
+
+  uint64_t bits;
+  if (sizeof(double) == 8)
+    memcpy(&bits, &value, sizeof(double));
+  else {
+    uint32_t bits32;
+    memcpy(&bits32, &value, sizeof(bits32));
+    bits = bits32;
+  }
+
+  bool bNegative = ((bits >> (8 * sizeof(double) - 1)) & 1) != 0;
+  int exponent = (int) ((bits >> mantissa_bits) & exponent_max);
+  uint64_t mantissa = bits & ((((uint64_t) 1) << mantissa_bits) - 1);
+
+  if (exponent == exponent_max) { // inf or nan
+    pad(3 + bNegative, bNegative, false);
+    append(mantissa ? "nan" : "inf");
+    return *this;
+  }
+  if (exponent)
+    mantissa |= ((uint64_t) 1) << mantissa_bits;
+  else
+    exponent = 1;
+  exponent -= exponent_max / 2 + mantissa_bits; // so that |value| = mantissa * 2^exponent
+
+  /* the arithmetic needs (mantissa + exponent + 3.5 * precision) bits, plus room for the base 10^9
+   * digits; typical values fit in a small scratch, and only very large ones need the rest
+   */
+  int words = (mantissa_bits + 1 + ((exponent > 0) ? exponent : 0) + (7 * m_precision) / 2) / 32 + 2;
+  words += words / 8 + 3;
+
+  if (words <= FixedScratchSmall) {
+    uint32_t scratch[FixedScratchSmall];
+    append_fixed(bNegative, exponent, mantissa, scratch, FixedScratchSmall);
+  } else
+    append_fixed_large(bNegative, exponent, mantissa);
+
+  return *this;
+}
+
+void ShellBuffer::append_fixed_large(bool bNegative, int exponent, uint64_t mantissa) {
+  uint32_t scratch[FixedScratchLarge];
+  append_fixed(bNegative, exponent, mantissa, scratch, FixedScratchLarge);
+}
+
+void ShellBuffer::append_fixed(bool bNegative, int exponent, uint64_t mantissa, uint32_t *scratch, int size) {
+  /* R = |value| * 10^precision, rounded to the nearest integer (ties to even, as glibc's printf)
+   */
+  static const uint32_t pow10[] = { 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000 };
+
+  Limbs R(scratch, mantissa);
+  for (int p = m_precision; p > 0; p -= 9)
+    R.mul(pow10[(p > 9) ? 9 : p]);
+
+  if (exponent >= 0)
+    R.shl(exponent);
+  else {
+    int shift = -exponent;
+    bool bHalf = R.bit(shift - 1);
+    bool bSticky = R.any_below(shift - 1);
+    R.shr(shift);
+    if (bHalf && (bSticky || R.bit(0)))
+      R.increment();
+  }
+
+  /* R in base 10^9, least significant first, filling the scratch down from the top as R shrinks
+   */
+  uint32_t *chunks = scratch + size;
+  int n = 0;
+  while (!R.is_zero()) {
+    uint32_t chunk = R.div(1000000000);
+    *--chunks = chunk;
+    ++n;
+  }
+
+  char top[10];
+  int top_count = n ? format_decimal(chunks[0], top) : 0;
+
+  int count = n ? (9 * (n - 1) + top_count) : 0;
+  int point = (count > m_precision) ? (count - m_precision) : 1; // digits before the decimal point
+  int zeros = point + m_precision - count;                       // leading zeros
+
+  pad(bNegative + point + m_precision + (m_precision ? 1 : 0), bNegative, m_fill == '0');
+
+  int position = 0;
+  while (zeros--)
+    s_append_digits(*this, "0", 1, position, point);
+  if (n)
+    s_append_digits(*this, top, top_count, position, point);
+  for (int i = 1; i < n; i++) {
+    char digits[10];
+    int length = format_decimal(chunks[i], digits);
+    for (int z = length; z < 9; z++)
+      s_append_digits(*this, "0", 1, position, point);
+    s_append_digits(*this, digits, length, position, point);
+  }
+}
@@ -10,25 +10,70 @@
 
 #include <ShellUtils.hh>
 
+#include <float.h>
+
 namespace MultiShell {
 
+  /* Manipulators for ShellBuffer's operator<<, e.g., B << width(8) << precision(3) << 1.5f; gives "   1.500";
+   * as with printf, the width (filled with ' ' or '0') applies to the next value only, while the precision
+   * (default 6) and the base persist until changed, or until the buffer is cleared.
+   */
+  struct ShellWidth {
+    uint8_t m_width;
+    char    m_fill;
+  };
+  struct ShellPrecision {
+    uint8_t m_precision;
+  };
+  enum ShellBase
+    {
+     sb_Decimal = 0,
+     sb_Hex,      // as %x (signed values as their unsigned bits)
+     sb_HexUpper  // as %X
+    };
+
   class ShellBuffer : public LinkedItem {
+  public:
+    static const int PrecisionMax = 20;
   private:
     char *m_buffer;
     char *m_strend;
 
     const char *m_bufend;
 
+    uint8_t m_width;     // formatting state for operator<<
+    char    m_fill;
+    uint8_t m_precision;
+    uint8_t m_base;
+
     static char m_tmp[16]; // Do not use; part of a linker hack
     static bool m_bInit;
 
     static void init();
-  
+
+    inline void reset_format() {
+      m_width = 0;
+      m_fill = ' ';
+      m_precision = 6;
+      m_base = sb_Decimal;
+    }
+    void pad(int length, bool bNegative, bool bZero); // writes any padding for the width, and the sign
+
+    /* scratch for append_fixed(), in 32-bit words: enough for |value| < 2^64 at any precision, or
+     * for any double at all (2^1024 * 10^PrecisionMax, or 2^128 * 10^PrecisionMax if double is 32-bit)
+     */
+    static const int FixedScratchSmall = 12;
+    static const int FixedScratchWords = (DBL_MAX_EXP + (7 * PrecisionMax) / 2) / 32 + 2;
+    static const int FixedScratchLarge = FixedScratchWords + FixedScratchWords / 8 + 3;
+
+    void append_fixed(bool bNegative, int exponent, uint64_t mantissa, uint32_t *scratch, int size);
+    void append_fixed_large(bool bNegative, int exponent, uint64_t mantissa); // the rest, with its own stack frame
   public:
     void init(char *buffer, int length) {
       m_buffer = buffer;
       m_strend = buffer;
       m_bufend = buffer + length;
+      reset_format();
     }
 
     ShellBuffer() :
@@ -37,6 +82,7 @@ namespace MultiShell {
       m_bufend(0)
     {
       if (m_bInit) init();
+      reset_format();
     }
     ShellBuffer(char *buffer, int length) :
       m_buffer(buffer),
@@ -44,6 +90,7 @@ namespace MultiShell {
       m_bufend(buffer + length)
     {
       if (m_bInit) init();
+      reset_format();
     }
     ~ShellBuffer() {
       // ...
@@ -66,6 +113,7 @@ namespace MultiShell {
     }
     inline ShellBuffer& clear() {
       m_strend = m_buffer;
+      reset_format();
       return *this;
     }
     inline ShellBuffer& operator=(const char *str) {
@@ -112,17 +160,76 @@ namespace MultiShell {
       }
       return count;
     }
+
+    /* Decimal digits of value, two at a time from a table (no per-digit division); returns the digit count
+     */
+    static int format_decimal(unsigned long value, char *digits); // digits must have space for 20
+
+    /* Formatted output without vsnprintf; see operator<<() below, which matches printf's %d, %u, %x & %.*f
+     */
+    inline ShellBuffer& set_width(const ShellWidth& w) {
+      m_width = w.m_width;
+      m_fill = w.m_fill;
+      return *this;
+    }
+    inline ShellBuffer& set_precision(int precision) {
+      m_precision = (precision < 0) ? 0 : ((precision > PrecisionMax) ? PrecisionMax : precision);
+      return *this;
+    }
+    inline ShellBuffer& set_base(ShellBase base) {
+      m_base = base;
+      return *this;
+    }
+
+    ShellBuffer& append_signed(long value, unsigned long bits); // bits: value as unsigned, of its own width, for hex
+    ShellBuffer& append_unsigned(unsigned long value);
+    ShellBuffer& append_fixed(double value);                    // as %.*f, correctly rounded
   };
 
+  inline ShellWidth width(int w, char fill = ' ') {
+    ShellWidth sw = { (uint8_t) ((w < 0) ? 0 : ((w > 255) ? 255 : w)), fill };
+    return sw;
+  }
+  inline ShellPrecision precision(int p) {
+    ShellPrecision sp = { (uint8_t) ((p < 0) ? 0 : p) };
+    return sp;
+  }
+
   inline ShellBuffer& operator<<(ShellBuffer& lhs, const char *rhs) {
     lhs.append(rhs);
     return lhs;
   }
-  inline ShellBuffer& operator<<(ShellBuffer& lhs, char rhs) {
+  inline ShellBuffer& operator<<(ShellBuffer& lhs, char rhs) { // a single character (or data byte), not a number
     lhs.append(rhs);
     return lhs;
   }
 
+  inline ShellBuffer& operator<<(ShellBuffer& lhs, const ShellWidth& rhs) {
+    return lhs.set_width(rhs);
+  }
+  inline ShellBuffer& operator<<(ShellBuffer& lhs, const ShellPrecision& rhs) {
+    return lhs.set_precision(rhs.m_precision);
+  }
+  inline ShellBuffer& operator<<(ShellBuffer& lhs, ShellBase rhs) {
+    return lhs.set_base(rhs);
+  }
+
+  inline ShellBuffer& operator<<(ShellBuffer& lhs, int rhs) {
+    return lhs.append_signed(rhs, (unsigned int) rhs);
+  }
+  inline ShellBuffer& operator<<(ShellBuffer& lhs, long rhs) {
+    return lhs.append_signed(rhs, (unsigned long) rhs);
+  }
+  inline ShellBuffer& operator<<(ShellBuffer& lhs, unsigned int rhs) {
+    return lhs.append_unsigned(rhs);
+  }
+  inline ShellBuffer& operator<<(ShellBuffer& lhs, unsigned long rhs) {
+    return lhs.append_unsigned(rhs);
+  }
+  inline ShellBuffer& operator<<(ShellBuffer& lhs, double rhs) { // also float
+    return lhs.append_fixed(rhs);
+  }
+
 } // MultiShell
 
 #endif /* !__ShellBuffer_hh__ */
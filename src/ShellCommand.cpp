@@ -10,61 +10,154 @@
 
 using namespace MultiShell;
 
-void Args::first() {
-  if (*m_arg == 0) // empty string
-    return;
-
-  char *ptr = m_arg;
-  bool bContainsString = false;
-  InputState is = is_Processing;
+void Args::tokenise(char *command_buffer) {
+  char *ptr = command_buffer; // read
+  char *arg = command_buffer; // write; never ahead of ptr
 
   while (true) {
-    if (*ptr == 0) {
-      m_swap = 0;
+    while (*ptr == ' ')
+      ++ptr;
+    if (!*ptr)
       break;
+
+    bool bLast = (m_argc == MULTISHELL_MAX_ARGS - 1);
+    bool bString = false;
+
+    m_argv[m_argc++] = arg;
+
+    while (*ptr) {
+      if (*ptr == '"') {
+	bString = !bString;
+	++ptr;
+	continue;
+      }
+      if (*ptr == ' ' && !bString && !bLast)
+	break;
+      *arg++ = *ptr++;
     }
-    if ((*ptr == ' ') && (is == is_Processing)) {
-      m_swap = ' ';
-      *ptr = 0;
+    if (*ptr) // the space after
+      ++ptr;
+    *arg++ = 0;
+  }
+}
+
+static bool s_unsigned(const char *str, unsigned long limit, unsigned long& value) {
+  if (!*str)
+    return false;
+
+  unsigned long v = 0;
+  for ( ; *str; str++) {
+    unsigned long d = (unsigned char) (*str - '0');
+    if (d > 9)
+      return false;
+    if (v > (limit - d) / 10) // out of range
+      return false;
+    v = v * 10 + d;
+  }
+  value = v;
+  return true;
+}
+
+bool Args::to_int(int index, int& value) const {
+  const char *str = (*this)[index];
+
+  bool bNegative = (*str == '-');
+  if (bNegative || *str == '+')
+    ++str;
+
+  unsigned long max = ~0U >> 1;
+  unsigned long v;
+  if (!s_unsigned(str, bNegative ? max + 1 : max, v))
+    return false;
+
+  value = bNegative ? (v ? -(int) (v - 1) - 1 : 0) : (int) v;
+  return true;
+}
+
+bool Args::to_uint(int index, unsigned& value) const {
+  const char *str = (*this)[index];
+  if (*str == '+')
+    ++str;
+
+  unsigned long v;
+  if (!s_unsigned(str, ~0U, v))
+    return false;
+
+  value = (unsigned) v;
+  return true;
+}
+
+bool Args::to_float(int index, float& value) const {
+  const char *str = (*this)[index];
+
+  bool bNegative = (*str == '-');
+  if (bNegative || *str == '+')
+    ++str;
+
+  unsigned long mantissa = 0; // up to 9 significant digits
+  int  exponent = 0;
+  bool bDigits  = false;
+  bool bPoint   = false;
+
+  for ( ; *str; str++) {
+    if (*str == '.' && !bPoint) {
+      bPoint = true;
+      continue;
+    }
+    unsigned long d = (unsigned char) (*str - '0');
+    if (d > 9)
       break;
+    bDigits = true;
+    if (mantissa < 100000000UL) {
+      mantissa = mantissa * 10 + d;
+      if (bPoint)
+	--exponent;
+    } else if (!bPoint) {
+      ++exponent;
     }
-    if (*ptr == '"') {
-      bContainsString = true;
+  }
+  if (!bDigits)
+    return false;
 
-      if (is == is_Processing)
-        is = is_String;
-      else
-        is = is_Processing;
+  if (*str == 'e' || *str == 'E') {
+    ++str;
+    bool bNegExp = (*str == '-');
+    if (bNegExp || *str == '+')
+      ++str;
+
+    int e = 0;
+    if (!*str)
+      return false;
+    for ( ; *str; str++) {
+      int d = (unsigned char) (*str - '0');
+      if (d > 9)
+	return false;
+      if (e < 100)
+	e = e * 10 + d;
     }
-    ++ptr;
+    exponent += bNegExp ? -e : e;
   }
-  if (bContainsString) {
-    char * one = ptr - 1;
-    char * two = one;
+  if (*str)
+    return false;
 
-    while (one >= m_arg) {
-      if (*one == '"') {
-        --one;
-        continue;
-      }
-      if (one < two)
-        *two = *one;
-      --one;
-      --two;
-    }
-    m_arg = two + 1;
+  float scale = 1; // 10^|exponent|, by squaring
+  float power = 10;
+  for (int n = (exponent < 0) ? -exponent : exponent; n; n >>= 1) {
+    if (n & 1)
+      scale *= power;
+    power *= power;
   }
-}
+  float f = (exponent < 0) ? (float) mantissa / scale : (float) mantissa * scale;
 
-void Args::next() {
-  while (*m_arg) // find end of current string
-    ++m_arg;
-  *m_arg = m_swap; // restore
+  value = bNegative ? -f : f;
+  return true;
+}
 
-  if (m_swap) {
-    ++m_arg; // proceed to next
-    first(); // process
-  }
+bool Args::match(const char *flag) const {
+  for (int i = 1; i < m_argc; i++)
+    if (strcmp(m_argv[i], flag) == 0)
+      return true;
+  return false;
 }
 
 Command::~Command() {
@@ -84,6 +177,86 @@ CommandList::~CommandList() {
   // ...
 }
 
+static inline const Command *s_command(const Command& command) { return &command; }
+static inline const Command *s_command(const Command *command) { return command; }
+
+template<class T> static const Command *s_search(const T *table, int count, const char *command) {
+  int lo = 0;
+  int hi = count;
+
+  while (lo < hi) { // first with name >= command
+    int mid = (lo + hi) / 2;
+    if (strcmp(s_command(table[mid])->command(), command) < 0)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  if (lo < count && strcmp(s_command(table[lo])->command(), command) == 0)
+    return s_command(table[lo]);
+  return 0;
+}
+
+void CommandList::insert(const Command& command) {
+  ++m_added;
+
+  if (!command.command() || m_indexed == MULTISHELL_COMMAND_INDEX) { // found by linear search instead
+    ++m_unindexed;
+    return;
+  }
+  if (s_search(m_table, m_table_count, command.command())) // the table was added first, and takes precedence
+    return;
+
+  int i = m_indexed++;
+  while (i && strcmp(m_index[i-1]->command(), command.command()) > 0) { // after any of the same name
+    m_index[i] = m_index[i-1];
+    --i;
+  }
+  m_index[i] = &command;
+}
+
+void CommandList::add_table(Command *table, int count, ShellHandler *handler) {
+  bool bTable = !m_table;
+
+  for (int i = 0; bTable && i < count; i++) // the table must be in name order, else it's indexed as usual
+    if (!table[i].command() || (i && strcmp(table[i-1].command(), table[i].command()) > 0))
+      bTable = false;
+
+  for (int i = 0; i < count; i++) {
+    table[i].set_handler(handler);
+    push(table[i]);
+    if (bTable)
+      ++m_added;
+    else
+      insert(table[i]);
+  }
+  if (bTable) {
+    m_table = table;
+    m_table_count = count;
+  }
+}
+
+const Command *CommandList::lookup(const char *command) const {
+  if (count() == m_added) { // the index first: any command of the same name in the table was added later
+    const Command *match = s_search(m_index, m_indexed, command);
+    if (!match)
+      match = s_search(m_table, m_table_count, command);
+    if (match || !m_unindexed)
+      return match;
+  }
+
+  for (const PrintableItem& item : *this) { // not all indexed
+    const Command& sc = (const Command&) item;
+
+    const char *item_command = sc.command();
+    if (!item_command) // shouldn't happen
+      continue;
+
+    if (strcmp(item_command, command) == 0)
+      return &sc;
+  }
+  return 0;
+}
+
 void ShellHandler::shell_notification(Shell& origin, const char *message) {
   // ...
 }
@@ -92,15 +265,32 @@ void ShellHandler::comma_command(Shell& origin, CommaCommand& command) {
   // ...
 }
 
+void ShellHandler::comma_vector(Shell& origin, CommaVector& vector) {
+  // ...
+}
+
 CommandError ShellHandler::shell_command(Shell& origin, Args& args) {
   return ce_Okay;
 }
 
+CommandError ShellHandler::resume_command(Shell& origin, PendingState& state) {
+  return ce_Okay;
+}
+
 CommandError CommandList::shell_command(Shell& origin, Args& args) {
   if (args == "RSVP") {
     origin.respond_to_RSVP();
     return ce_Okay;
   }
+  if (args == "binary") {
+    origin.set_binary(true);
+    origin.respond_to_RSVP();
+    return ce_Okay;
+  }
+  if (args == "resync") {
+    origin.resync();
+    return ce_Okay;
+  }
   if (args == "help") {
     origin << *this;
     return ce_Okay;
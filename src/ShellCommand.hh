@@ -14,29 +14,57 @@ namespace MultiShell {
 
   class Shell;
 
+  /* The command buffer is split into arguments (and quotes removed) in place, once, on construction;
+   * ++args steps through them, or use args[i] for i < argc(); either gives "" when past the end
+   */
   class Args {
   private:
-    char *m_arg;
-    char  m_swap;
+    char *m_argv[MULTISHELL_MAX_ARGS]; // see ShellConfig.hh
+    int   m_argc;
+    int   m_index; // current argument
 
-    void first();
-    void next();
+    void tokenise(char *command_buffer);
 
   public:
     Args(char *command_buffer) :
-      m_arg(command_buffer),
-      m_swap(0)
+      m_argc(0),
+      m_index(0)
     {
-      first();
+      tokenise(command_buffer);
     }
     ~Args() {
       // ...
     }
     inline Args& operator++() {
-      next();
+      if (m_index < m_argc)
+	++m_index;
       return *this;
     }
-    inline const char *c_str() const { return m_arg; }
+    inline const char *c_str() const { return (*this)[m_index]; }
+
+    inline int argc() const { return m_argc; }
+    inline const char *operator[](int index) const {
+      return (index >= 0 && index < m_argc) ? m_argv[index] : "";
+    }
+
+    /* Typed arguments, without scanf: the whole argument must be a decimal number (floats may have a
+     * fraction and an exponent); otherwise, or if out of range, these return false and leave value alone
+     */
+    bool to_int(int index, int& value) const;
+    bool to_uint(int index, unsigned& value) const;
+    bool to_float(int index, float& value) const;
+
+    inline bool to_int(int& value) const { // the current argument
+      return to_int(m_index, value);
+    }
+    inline bool to_uint(unsigned& value) const {
+      return to_uint(m_index, value);
+    }
+    inline bool to_float(float& value) const {
+      return to_float(m_index, value);
+    }
+
+    bool match(const char *flag) const; // whether any argument after the command is flag, e.g., "--reset"
   };
 
   inline bool operator==(Args& lhs, const char *rhs) {
@@ -46,12 +74,27 @@ namespace MultiShell {
     return (strcmp(lhs.c_str(), rhs) != 0);
   }
 
+  /* Each shell's state of its command in progress, so that one handler can serve several shells at once
+   */
+  struct PendingState {
+    unsigned long m_since; // millis() when the command started
+    unsigned long m_value; // for the handler's use, e.g., a duration or a count; 0 to begin with
+    void         *m_data;  // for the handler's use; 0 to begin with
+  };
+
   class ShellHandler {
   public:
     virtual void shell_notification(Shell& origin, const char *message);
     virtual void comma_command(Shell& origin, CommaCommand& command);
+    virtual void comma_vector(Shell& origin, CommaVector& vector); // all values of a vector, together
     virtual CommandError shell_command(Shell& origin, Args& args);
 
+    /* A slow command can return ce_Pending from shell_command(), keeping its state in origin.pending(); it
+     * is then resumed on each later update of that shell until it returns anything else, and meanwhile the
+     * shell's input waits, while other shells, and output, carry on
+     */
+    virtual CommandError resume_command(Shell& origin, PendingState& state);
+
     virtual ~ShellHandler() { }
   };
 
@@ -89,23 +132,54 @@ namespace MultiShell {
     virtual const char *printable(int index, int& offset) const;
   };
 
+  /* strcmp(), but usable at compile time, e.g., to check an array of names:
+   *   static constexpr const char *names[] = { "alpha", "beta", "gamma" };
+   *   static_assert(command_names_sorted(names), "names not in order");
+   * This checks the names array only, not a Command table (which can't be constexpr); the order of the
+   * table given to CommandList::add_table() is checked at runtime. A table built from names[i] in turn
+   * (see linux/benchmark.cc) follows the checked order, but nothing enforces that it does.
+   */
+  constexpr int command_compare(const char *lhs, const char *rhs) {
+    return (*lhs != *rhs || !*lhs) ? ((int) (unsigned char) *lhs - (int) (unsigned char) *rhs) : command_compare(lhs + 1, rhs + 1);
+  }
+  template<size_t N> constexpr bool command_names_sorted(const char *const (&names)[N], size_t i = 1) {
+    return (i >= N) || ((command_compare(names[i - 1], names[i]) < 0) && command_names_sorted(names, i + 1));
+  }
+
   class CommandList : public ShellHandler, public PrintableList {
   private:
     Command       m_help;
     Command       m_RSVP;
+    Command       m_binary;
+    Command       m_resync;
     ShellHandler *m_default_handler;
 
+    const Command *m_index[MULTISHELL_COMMAND_INDEX]; // binary search by name; see ShellConfig.hh
+    int            m_indexed;
+    const Command *m_table;   // see add_table()
+    int            m_table_count;
+    int            m_added;   // by add() & add_table(); if the list differs, lookup() falls back to a linear search
+    int            m_unindexed; // added, but in neither the index nor the table
+
+    void insert(const Command& command);
   public:
     CommandList(ShellHandler *default_handler = 0) :
       m_help("help", "help", "List all commands and usage."),
       m_RSVP("RSVP", "RSVP", "Send acknowledgement (ASCII Code 6 = ACK)."),
-      m_default_handler(default_handler)
+      m_binary("binary", "binary", "Switch CommaComms to binary frames; acknowledges (ACK) when switched."),
+      m_resync("resync", "resync", "Send the next value for each compact CommaComms letter in full."),
+      m_default_handler(default_handler),
+      m_indexed(0),
+      m_table(0),
+      m_table_count(0),
+      m_added(0),
+      m_unindexed(0)
     {
-      m_help.set_handler(this);
-      m_RSVP.set_handler(this);
-
-      push(m_help);
-      push(m_RSVP);
+      config_check();
+      add(m_help, this);
+      add(m_RSVP, this);
+      add(m_binary, this);
+      add(m_resync, this);
     }
     virtual ~CommandList();
 
@@ -122,29 +196,19 @@ namespace MultiShell {
       return (const Command *) item(index);
     }
 
-    inline void add(Command& command, ShellHandler *handler = 0) {
+    inline void add(Command& command, ShellHandler *handler = 0) { // a command can be in one list only
       command.set_handler(handler);
       push(command);
+      insert(command);
     }
-    const Command *lookup(const char *command) const {
-      const Command *match = 0;
-
-      for (int i = 0; i < count(); i++) {
-	const Command *sc = (const Command *) item(i);
-	if (!sc) // shouldn't happen
-	  break;
-
-	const char *item_command = sc->command();
-	if (!item_command) // shouldn't happen
-	  continue;
-
-	if (strcmp(item_command, command) == 0) {
-	  match = sc;
-	  break;
-	}
-      }
-      return match;
-    }
+
+    /* Adds an array of commands in name order, which is searched in place rather than indexed; the order is
+     * checked, and a table out of order is indexed instead, as are any tables after the first; as with add(),
+     * if two commands have the same name, the first added is found
+     */
+    void add_table(Command *table, int count, ShellHandler *handler = 0);
+
+    const Command *lookup(const char *command) const; // O(log n), if all commands were added as above
 
     /* PrintableList:
      * use defaults, i.e., no list-specific printables, no selection
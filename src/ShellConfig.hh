@@ -0,0 +1,119 @@
+/* -*- mode: c++ -*-
+ * 
+ * Copyright 2022 Francis James Franklin
+ * 
+ * Open Source under the MIT License - see LICENSE in the project's root folder
+ */
+
+#ifndef __ShellConfig_hh__
+#define __ShellConfig_hh__
+
+/* Build configuration: the sizes of the Repository's pools, and of the command line, its arguments and the
+ * command index. Override any of these with a global build flag, e.g., -DMULTISHELL_COMMA_TASKS=32 (or
+ * build_flags in platformio.ini, or compiler.cpp.extra_flags in Arduino's platform.local.txt), so that the
+ * library and the sketch are built alike; the values must be plain numbers.
+ *
+ * Don't #define them in a sketch: the library is compiled separately and the class layouts would differ.
+ * The sketch would fail to link, with an undefined reference to multishell_config_<values>, the
+ * configuration the sketch was compiled with; see config_check().
+ */
+
+/* Pool sizes of the Repository; the buffer-task chunk sizes must be in increasing order, and the counts at
+ * least 1, except for the optional pools (vectors, batches, owned buffers and broadcasts), which are kept
+ * small and can be compiled out with a count of 0, so that their dispatch functions return false
+ */
+#ifndef MULTISHELL_TMP_BUFFERS
+#define MULTISHELL_TMP_BUFFERS     4   // general purpose buffers, i.e., tmp_buffer()
+#endif
+#ifndef MULTISHELL_TMP_BUFSIZE
+#define MULTISHELL_TMP_BUFSIZE   128
+#endif
+#ifndef MULTISHELL_OFFSET_STRINGS
+#define MULTISHELL_OFFSET_STRINGS 16
+#endif
+#ifndef MULTISHELL_PRINTABLE_LISTS
+#define MULTISHELL_PRINTABLE_LISTS 2
+#endif
+#ifndef MULTISHELL_COMMA_TASKS
+#define MULTISHELL_COMMA_TASKS    16
+#endif
+#ifndef MULTISHELL_COMMA_VECTORS
+#define MULTISHELL_COMMA_VECTORS   1
+#endif
+#ifndef MULTISHELL_COMMA_BATCHES
+#define MULTISHELL_COMMA_BATCHES   1
+#endif
+#ifndef MULTISHELL_OWNED_BUFFERS
+#define MULTISHELL_OWNED_BUFFERS   1   // tasks for dispatch_owned(); 0 to copy instead
+#endif
+#ifndef MULTISHELL_BROADCASTS
+#define MULTISHELL_BROADCASTS      1   // payloads shared between shells
+#endif
+#ifndef MULTISHELL_BROADCAST_TASKS
+#define MULTISHELL_BROADCAST_TASKS 2   // one per shell per payload
+#endif
+#ifndef MULTISHELL_SMALL_BUFFERS
+#define MULTISHELL_SMALL_BUFFERS  16   // buffer tasks, for dispatch_buffer()
+#endif
+#ifndef MULTISHELL_SMALL_BUFSIZE
+#define MULTISHELL_SMALL_BUFSIZE  16
+#endif
+#ifndef MULTISHELL_MEDIUM_BUFFERS
+#define MULTISHELL_MEDIUM_BUFFERS  8
+#endif
+#ifndef MULTISHELL_MEDIUM_BUFSIZE
+#define MULTISHELL_MEDIUM_BUFSIZE 32
+#endif
+#ifndef MULTISHELL_LARGE_BUFFERS
+#define MULTISHELL_LARGE_BUFFERS   4
+#endif
+#ifndef MULTISHELL_LARGE_BUFSIZE
+#define MULTISHELL_LARGE_BUFSIZE  64
+#endif
+
+/* Default size of a SizedShell's command-line buffer, i.e., SizedShell<>; this sets only the default template
+ * argument, so unlike the others it can differ between files
+ */
+#ifndef MULTISHELL_COMMAND_BUFSIZE
+#define MULTISHELL_COMMAND_BUFSIZE  64
+#endif
+
+/* Maximum number of arguments, including the command; any further words are left in the last argument
+ */
+#ifndef MULTISHELL_MAX_ARGS
+#define MULTISHELL_MAX_ARGS  16
+#endif
+
+/* Size of CommandList's index of commands sorted by name; any commands beyond this are found by a linear
+ * search
+ */
+#ifndef MULTISHELL_COMMAND_INDEX
+#define MULTISHELL_COMMAND_INDEX  32
+#endif
+
+#define MULTISHELL_CONFIG_NAME_(a,b,c,d,e,f,g,h,i,j,k,l,m,n,o,p,q,r) \
+  multishell_config_##a##_##b##_##c##_##d##_##e##_##f##_##g##_##h##_##i##_##j##_##k##_##l##_##m##_##n##_##o##_##p##_##q##_##r
+#define MULTISHELL_CONFIG_NAME(a,b,c,d,e,f,g,h,i,j,k,l,m,n,o,p,q,r) \
+  MULTISHELL_CONFIG_NAME_(a,b,c,d,e,f,g,h,i,j,k,l,m,n,o,p,q,r)
+
+#define MULTISHELL_CONFIG MULTISHELL_CONFIG_NAME(MULTISHELL_TMP_BUFFERS, MULTISHELL_TMP_BUFSIZE, \
+  MULTISHELL_OFFSET_STRINGS, MULTISHELL_PRINTABLE_LISTS, MULTISHELL_COMMA_TASKS, MULTISHELL_COMMA_VECTORS, \
+  MULTISHELL_COMMA_BATCHES, MULTISHELL_OWNED_BUFFERS, MULTISHELL_BROADCASTS, MULTISHELL_BROADCAST_TASKS, \
+  MULTISHELL_SMALL_BUFFERS, MULTISHELL_SMALL_BUFSIZE, MULTISHELL_MEDIUM_BUFFERS, MULTISHELL_MEDIUM_BUFSIZE, \
+  MULTISHELL_LARGE_BUFFERS, MULTISHELL_LARGE_BUFSIZE, MULTISHELL_MAX_ARGS, \
+  MULTISHELL_COMMAND_INDEX)
+
+namespace MultiShell {
+
+  void MULTISHELL_CONFIG(); // defined (empty) by the library, named after the configuration it was built with
+
+  /* Called by the inline constructors of Shell and CommandList, so that any file that creates one refers to
+   * the configuration it was compiled with, and fails to link unless the library's is the same
+   */
+  inline void config_check() {
+    MULTISHELL_CONFIG();
+  }
+
+} // MultiShell
+
+#endif /* !__ShellConfig_hh__ */
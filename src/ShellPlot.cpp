@@ -25,13 +25,12 @@ void PlotTask::prepare() {
 
   m_x_max = -1;
 
-  for (int b = 0; b < m_owner_ds.count(); b++) {
-    const ShellBuffer *B = m_owner_ds.item(b);
-    if (m_x_max < B->count() - 1)
-      m_x_max = B->count() - 1;
+  for (const ShellBuffer& B : m_owner_ds) {
+    if (m_x_max < B.count() - 1)
+      m_x_max = B.count() - 1;
 
-    const char *ptr = B->buffer();
-    for (int i = 0; i < B->count(); i++) {
+    const char *ptr = B.buffer();
+    for (int i = 0; i < B.count(); i++) {
       char value = *ptr++;
       if (bFirst) {
 	bFirst = false;
@@ -55,6 +54,10 @@ void PlotTask::prepare() {
   m_col = 0;
 }
 
+void PlotTask::discard() {
+  finish();
+}
+
 bool PlotTask::process_task(ShellStream& stream, int& afw) { // returns true on completion of task
   if (!m_owner_ds.count() || m_x_max < 0) { // hmm... no data
     finish();
@@ -71,7 +74,9 @@ bool PlotTask::process_task(ShellStream& stream, int& afw) { // returns true on
 	continue;
       }
       if (!m_col) {     // y-axis value in this row
-	snprintf(m_tmp, 5, "%4d", m_row * m_scale);
+	ShellBuffer label(m_tmp, 5);
+	label << width(4) << m_row * m_scale;
+	label.c_str();
       }
       stream.write(m_tmp[m_col++], afw);
       continue;
@@ -99,16 +104,17 @@ bool PlotTask::process_task(ShellStream& stream, int& afw) { // returns true on
     int y_max = m_row * m_scale + m_scale / 2;
     int y_min = m_row * m_scale - m_scale / 2;
 
-    for (int b = 0; b < m_owner_ds.count(); b++) {
-      const ShellBuffer *B = m_owner_ds.item(b);
-      if (x < B->count()) {
-	const char *ptr = B->buffer() + x;
+    int b = 0;
+    for (const ShellBuffer& B : m_owner_ds) {
+      if (x < B.count()) {
+	const char *ptr = B.buffer() + x;
 
 	char value = *ptr;
 	if (value >= y_min && value <= y_max) {
 	  bg = (b < 26) ? ('a' + b) : '?';
 	}
       }
+      ++b;
     }
     stream.write(bg, afw);
     ++m_col;
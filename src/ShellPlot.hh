@@ -39,6 +39,8 @@ namespace MultiShell {
     }
   public:
     virtual bool process_task(ShellStream& stream, int& afw); // returns true on completion of task
+
+    virtual void discard(); // returns the datasets to their owner
   };
 
   class PlotDemo : public OptionList {
@@ -75,11 +75,15 @@ int ShellStream::read(ShellBuffer& buffer) {
     if (space < afr)
       afr = space;
     while (afr) {
-      int value = read(afr);
-      if (value < 0)
+      char chunk[32];
+      int length = read(chunk, (afr < 32) ? afr : 32);
+      if (!length)
 	break;
-      buffer << (char) value;
-      ++count;
+      control_bytes(chunk, length);
+      for (int i = 0; i < length; i++)
+	buffer << chunk[i];
+      count += length;
+      afr -= length;
     }
   }
   return count;
@@ -162,7 +166,7 @@ int ShellStream::read(int& afr) {
     value = m_serial->read();
   }
   if (value >= 0) {
-    if (m_responder) {
+    if (m_responder && !m_bRaw) {
       if (value == 4)
 	m_responder->stream_notification(*this, "end");
       if (value == 6)
@@ -173,6 +177,48 @@ int ShellStream::read(int& afr) {
   return value;
 }
 
+int ShellStream::read(char *ptr, int max) {
+  int count = 0;
+
+  if (!ptr || max <= 0)
+    return count;
+
+#ifdef FEATHER_M0_BTLE
+  if (m_bt) {
+    count = m_bt_endptr - m_bt_bufptr;
+    if (count > max)
+      count = max;
+    memcpy(ptr, m_bt_bufptr, count);
+    m_bt_bufptr += count;
+  }
+#endif
+#if defined(TEENSYDUINO) || defined(ADAFRUIT_FEATHER_M0)
+  if (m_usbser) {
+    int available = m_usbser->available(); // so that readBytes() doesn't wait
+    count = m_usbser->readBytes(ptr, (max < available) ? max : available);
+  }
+#endif
+  if (m_serial) {
+#ifdef OS_Linux
+    count = m_serial->read(ptr, max);
+#else
+    int available = m_serial->available();
+    count = m_serial->readBytes(ptr, (max < available) ? max : available);
+#endif
+  }
+  return count; // control bytes are reported by the parser, once it knows the mode (text or binary)
+}
+
+void ShellStream::notify_control(char c) {
+  m_responder->stream_notification(*this, (c == 4) ? "end" : "RSVP");
+}
+
+void ShellStream::control_bytes(const char *ptr, int length) {
+  if (m_responder && !m_bRaw) // one pass for the control bytes
+    for (int i = 0; i < length; i++)
+      control_byte(ptr[i]);
+}
+
 int ShellStream::write_eol(int& afw) {
   if (afw < m_eol_length) {
     afw = 0;
@@ -184,6 +230,14 @@ int ShellStream::write_eol(int& afw) {
     write_char(*eolptr++);
     --afw;
   }
+  m_bBoundary = true;
+
+  if (m_bYield) { // let the task list switch lanes here
+    m_bYield = false;
+    m_yield_afw = (afw < m_eol_length) ? 0 : afw;
+    afw = 0;
+    return m_eol_length;
+  }
 
   if (afw < m_eol_length)
     afw = 0;
@@ -197,6 +251,72 @@ int ShellStream::write(char c, int& afw) {
     return write_eol(afw);
 
   write_char(c);
+  m_bBoundary = false;
+
+  if (--afw < m_eol_length)
+    afw = 0;
+  return 1;
+}
+
+int ShellStream::write(const char *ptr, int length, int& afw) {
+  if (!ptr)
+    return 0;
+
+  int consumed = 0;
+
+  while (consumed < length && afw) {
+    int run = afw - m_eol_length + 1; // after a run, afw must still be sufficient for an EOL, or zero
+    if (run < 1)
+      run = 1;
+    if (run > length - consumed)
+      run = length - consumed;
+
+    const char *start = ptr + consumed;
+    int count = 0;
+    while (count < run) {
+      char c = start[count];
+      if (!c || c == '\r' || c == '\n')
+	break;
+      ++count;
+    }
+    if (count) {
+      write_chars(start, count);
+      m_bBoundary = false;
+
+      consumed += count;
+      afw -= count;
+      if (afw < m_eol_length)
+	afw = 0;
+      continue;
+    }
+
+    if (!start[0]) // end of string
+      break;
+    if (start[0] == '\n') // otherwise '\r', which is skipped
+      write_eol(afw);
+    ++consumed;
+  }
+  return consumed;
+}
+
+int ShellStream::write_buffer(const char *ptr, int length, int& afw) {
+  int consumed = 0;
+
+  while (consumed < length && afw) {
+    if (!ptr[consumed])
+      ++consumed;
+    else
+      consumed += write(ptr + consumed, length - consumed, afw);
+  }
+  return consumed;
+}
+
+int ShellStream::write_byte(char c, int& afw) {
+  if (!afw)
+    return 0;
+
+  write_char(c);
+  m_bBoundary = false;
 
   if (--afw < m_eol_length)
     afw = 0;
@@ -219,6 +339,26 @@ void ShellStream::write_char(char c) {
   }
 }
 
+void ShellStream::write_chars(const char *ptr, int length) {
+#ifdef FEATHER_M0_BTLE
+  if (m_bt) {
+    m_bt->write((const uint8_t *) ptr, length);
+  }
+#endif
+#if defined(TEENSYDUINO) || defined(ADAFRUIT_FEATHER_M0)
+  if (m_usbser) {
+    m_usbser->write((const uint8_t *) ptr, length);
+  }
+#endif
+  if (m_serial) {
+#ifdef OS_Linux
+    m_serial->write(ptr, length);
+#else
+    m_serial->write((const uint8_t *) ptr, length);
+#endif
+  }
+}
+
 int ShellStream::sync_write_begin() {
   int count = 0;
 #ifdef FEATHER_M0_BTLE
@@ -28,6 +28,10 @@ namespace MultiShell {
     };
   private:
     Responder *m_responder;
+    bool       m_bRaw;
+    bool       m_bBoundary; // output is at a line (or frame) boundary
+    bool       m_bYield;    // stop the writer at the next EOL
+    int        m_yield_afw; // afw withheld at that EOL, or -1
 
     const char *m_eol;
     int         m_eol_length;
@@ -62,6 +66,8 @@ namespace MultiShell {
       m_name[2] = 0;
     }
 
+    void notify_control(char c);
+
   public:
     inline const char *name() const {
       return m_name;
@@ -69,6 +75,27 @@ namespace MultiShell {
     inline void set_responder(Responder *responder) {
       m_responder = responder;
     }
+    inline void set_raw(bool bRaw) { // while raw (binary CommaComms), control bytes aren't reported to the responder
+      m_bRaw = bRaw;
+    }
+    inline void control_byte(char c) { // report 4 (end) or 6 (RSVP) to the responder as the input is parsed
+      if ((c == 4 || c == 6) && m_responder && !m_bRaw)
+	notify_control(c);
+    }
+    void control_bytes(const char *ptr, int length); // the same, for a span of parsed text input
+    inline bool at_boundary() const { // true if output is at the start of a line, or between frames
+      return m_bBoundary;
+    }
+    inline void set_boundary() { // for tasks that write self-delimited messages, e.g., CommaComms
+      m_bBoundary = true;
+    }
+    inline void yield_at_boundary(bool bYield) { // if set, the next EOL sets afw to 0, withholding the rest
+      m_bYield = bYield;
+      m_yield_afw = -1;
+    }
+    inline int yielded() const { // afw withheld, or -1 if not yielded
+      return m_yield_afw;
+    }
     inline void set_eol(const char *eol_str) {
       if (eol_str) {
 	m_eol = eol_str;
@@ -79,6 +106,10 @@ namespace MultiShell {
 #ifdef OS_Linux
     ShellStream(VirtualSerial& serial, char identifier = '?') :
       m_responder(0),
+      m_bRaw(false),
+      m_bBoundary(true),
+      m_bYield(false),
+      m_yield_afw(-1),
       m_serial(&serial)
     {
       set_name('v', identifier);
@@ -87,6 +118,10 @@ namespace MultiShell {
 #else
     ShellStream(HardwareSerial& serial, char identifier = '?') :
       m_responder(0),
+      m_bRaw(false),
+      m_bBoundary(true),
+      m_bYield(false),
+      m_yield_afw(-1),
 #ifdef FEATHER_M0_BTLE
       m_bt_bufptr(0),
       m_bt_endptr(0),
@@ -105,6 +140,10 @@ namespace MultiShell {
 #if defined(TEENSYDUINO)
     ShellStream(usb_serial_class& serial, char identifier = '?') :
       m_responder(0),
+      m_bRaw(false),
+      m_bBoundary(true),
+      m_bYield(false),
+      m_yield_afw(-1),
       m_usbser(&serial),
       m_serial(0)
     {
@@ -115,6 +154,10 @@ namespace MultiShell {
 #if defined(ADAFRUIT_FEATHER_M0)
     ShellStream(Serial_& serial, char identifier = '?') :
       m_responder(0),
+      m_bRaw(false),
+      m_bBoundary(true),
+      m_bYield(false),
+      m_yield_afw(-1),
 #ifdef FEATHER_M0_BTLE
       m_bt_bufptr(0),
       m_bt_endptr(0),
@@ -131,6 +174,10 @@ namespace MultiShell {
 #ifdef FEATHER_M0_BTLE
     ShellStream(Adafruit_BluefruitLE_SPI& bt, char identifier = '?') :
       m_responder(0),
+      m_bRaw(false),
+      m_bBoundary(true),
+      m_bYield(false),
+      m_yield_afw(-1),
       m_bt_bufptr(0),
       m_bt_endptr(0),
       m_bConnected(false),
@@ -175,12 +222,23 @@ namespace MultiShell {
 
     int  sync_read_begin();       // returns afr = available()
     int  read(int& afr);
+    int  read(char *ptr, int max); // reads up to max (<= afr) bytes; returns the number read
 
     int  sync_write_begin();      // returns afw = availableForWrite()
     void sync_write_end();
 
     int  write_eol(int& afw);     // these write functions track afw, which should
     int  write(char c, int& afw); // always be sufficient to write an EOL
+    int  write_byte(char c, int& afw); // raw byte, without EOL translation (e.g., CommaComms)
+
+    /* As write(char), but for a run of up to length characters, stopping at a NUL (not consumed); returns the
+     * number of characters consumed
+     */
+    int  write(const char *ptr, int length, int& afw);
+
+    /* As write(ptr, length, afw), but for a buffer that may contain NULs, which are skipped, as by write(char)
+     */
+    int  write_buffer(const char *ptr, int length, int& afw);
 
     inline void update() {
 #ifdef OS_Linux
@@ -189,6 +247,7 @@ namespace MultiShell {
     }
   private:
     void write_char(char c);
+    void write_chars(const char *ptr, int length);
   public:
 
 #ifdef OS_Linux
@@ -9,6 +9,8 @@
 #include "ShellStream.hh"
 #include "ShellTask.hh"
 
+#include <limits.h>
+
 using namespace MultiShell;
 
 Task::~Task() {
@@ -19,55 +21,201 @@ bool Task::process_task(ShellStream& stream, int& afw) { // returns true on comp
   return true;
 }
 
+bool Task::coalesce(const CommaCommand& command, bool bBinary) {
+  return false;
+}
+
+void Task::discard() {
+  // ...
+}
+
 TaskList::~TaskList() {
   // ...
 }
 
+void TaskList::set_deadline(Task& task) {
+  task.m_deadline = 0;
+
+  if (m_ttl) {
+    unsigned long deadline = millis() + m_ttl;
+    task.m_deadline = deadline ? deadline : 1;
+  }
+}
+
 void TaskList::linked_item_push(LinkedItem& item) {
   Task *tptr = (Task *) &item;
   tptr->m_flags = 0;
+  set_deadline(*tptr);
+
+  if (m_lane == tl_Control)
+    m_control.push(*tptr);
+  else
+    LinkedList::linked_item_push(item);
+}
+
+/* Writes the lane's pending EOLs and ACK, and then its current task, if any; returns 1 if the task
+ * completed or expired (and should be popped), 0 if not, and -1 if the lane has nothing to write, or
+ * its ACK is held
+ */
+int TaskList::process_lane(ShellStream& stream, int& afw, Task *current, unsigned char& flags, unsigned long now, bool bHoldACK) {
+  if (!flags && !current)
+    return -1;
+
+  while (afw) {
+    if (flags & Task::fMaskRSVP) {
+      if (bHoldACK)
+	return -1;
+      bool bBoundary = stream.at_boundary();
+      stream.write(6, afw); // acknowledge
+      if (bBoundary)        // a single byte, which doesn't break a line
+	stream.set_boundary();
+      flags &= ~Task::fMaskRSVP;
+      continue;
+    }
+
+    unsigned char eol_count = flags & Task::fMaskEOL;
+    if (eol_count) {
+      stream.write_eol(afw);
+      flags &= ~Task::fMaskEOL;
+      flags |= --eol_count;
+      continue;
+    }
+
+    if (!current)
+      return -1;
+
+    if (current->m_deadline && stream.at_boundary() && (long) (now - current->m_deadline) >= 0) {
+      current->discard();
+      flags = current->m_flags & Task::fMaskRSVP; // the task's EOLs go with it, but not the ACK
+      ++m_discarded;
+      return 1;
+    }
+
+    if (!current->process_task(stream, afw))
+      break;
 
-  LinkedList::linked_item_push(item);
+    flags = current->m_flags; // task complete
+    return 1;
+  }
+  return 0;
 }
 
 void TaskList::process_tasks(ShellStream& stream) {
-  if (!stream) // no active serial connection
+  if (!stream) { // no active serial connection
+    disconnected();
     return;
+  }
 
-  Task *current = (Task *) linked_item(0);
-  if (!m_flags && !current) // no tasks in queue
+  if (!m_flags && !m_control_flags && !count()) // no tasks in queue
     return;
 
   int afw = stream.sync_write_begin(); // afw will be 0 or sufficient
 
+  if (m_budget && afw > m_budget)
+    afw = m_budget;
+
+  unsigned long now = millis();
+
   if (afw) {
-    while ((m_flags || current) && afw) {
-      if (m_flags & Task::fMaskRSVP) {
-	stream.write(6, afw); // acknowledge
-	m_flags &= ~Task::fMaskRSVP;
-	continue;
+    while (afw) {
+      bool bControlWaiting = m_control_flags || m_control.count();
+      bool bBulkWaiting    = m_flags || LinkedList::count();
+
+      if (!bControlWaiting && !bBulkWaiting)
+	break;
+
+      bool bHoldACK = m_ack_wait && (m_flags & Task::fMaskRSVP); // the bulk lane is ready to ACK
+
+      bool bControl;
+      if (!bBulkWaiting || (bControlWaiting && stream.at_boundary()))
+	bControl = bControlWaiting;
+      else if (bHoldACK)
+	bControl = true; // the control tasks queued before the ACK go first
+      else
+	bControl = m_bControl && bControlWaiting; // finish the current line first
+      m_bControl = bControl;
+
+      int result;
+      if (bControl) {
+	result = process_lane(stream, afw, m_control.first(), m_control_flags, now, false);
+      } else if (!bControlWaiting) {
+	result = process_lane(stream, afw, (Task *) linked_item_next(0), m_flags, now, false);
+      } else { // stop at the end of the line to let the control lane in
+	stream.yield_at_boundary(true);
+	result = process_lane(stream, afw, (Task *) linked_item_next(0), m_flags, now, m_ack_wait != 0);
+	if (stream.yielded() > 0) {
+	  afw = stream.yielded();
+	  if (!result)
+	    result = -1; // next lane
+	}
+	stream.yield_at_boundary(false);
       }
 
-      unsigned char eol_count = m_flags & Task::fMaskEOL;
-      if (eol_count) {
-	stream.write_eol(afw);
-	m_flags &= ~Task::fMaskEOL;
-	m_flags |= --eol_count;
+      if (result > 0) { // task complete; return to owner, and carry on with the next
+	if (bControl)
+	  pop_control();
+	else
+	  LinkedList::pop_and_return();
 	continue;
       }
-
-      if (!current->process_task(stream, afw))
+      if (result == 0)
 	break;
-
-      // task complete; return to owner
-      m_flags = current->m_flags;
-      pop_and_return(); // current is no longer valid
-      break;
     }
     stream.sync_write_end();
   }
 }
 
+bool TaskList::coalesce(const CommaCommand& command, bool bBinary) { // only in the lane for new tasks
+  if (m_lane == tl_Control) {
+    for (Task& task : m_control) {
+      if (task.coalesce(command, bBinary)) {
+	set_deadline(task);
+	++m_coalesced;
+	return true;
+      }
+    }
+    return false;
+  }
+  for (LinkedItem *iptr = linked_item_next(0); iptr; iptr = linked_item_next(iptr)) {
+    if (((Task *) iptr)->coalesce(command, bBinary)) {
+      set_deadline(*(Task *) iptr);
+      ++m_coalesced;
+      return true;
+    }
+  }
+  return false;
+}
+
+void TaskList::flush(bool bControl) {
+  unsigned char rsvp = m_flags & Task::fMaskRSVP;
+
+  while (LinkedList::count()) {
+    Task *tptr = (Task *) linked_item_next(0);
+    rsvp |= tptr->m_flags & Task::fMaskRSVP;
+    tptr->discard();
+    LinkedList::pop_and_return();
+    ++m_discarded;
+  }
+  m_flags = 0;
+  m_ack_wait = 0;
+
+  if (bControl) {
+    while (m_control.count()) {
+      m_control.first()->discard();
+      m_control.pop_and_return();
+      ++m_discarded;
+    }
+    m_control_flags = 0;
+  } else if (rsvp) { // the output goes, but not the ACK, which now follows the control lane
+    Task *tptr = m_control.last();
+    if (tptr)
+      tptr->m_flags |= rsvp;
+    else
+      m_control_flags |= rsvp;
+  }
+  m_bControl = false;
+}
+
 Task_OffsetString::~Task_OffsetString() {
   // ...
 }
@@ -84,9 +232,8 @@ bool Task_OffsetString::process_task(ShellStream& stream, int& afw) { // returns
       --m_offset;
       continue;
     }
-    if (*m_str) {
-      stream.write(*m_str, afw);
-      ++m_str;
+    if (*m_str) { // up to the NUL, as it is now
+      m_str += stream.write(m_str, INT_MAX, afw);
       continue;
     }
     bDone = true;
@@ -107,8 +254,7 @@ bool Task_Buffer::process_task(ShellStream& stream, int& afw) { // returns true
 
   while (afw) {
     if (m_bufptr < m_bufend) {
-      stream.write(*m_bufptr, afw);
-      ++m_bufptr;
+      m_bufptr += stream.write_buffer(m_bufptr, m_bufend - m_bufptr, afw);
       continue;
     }
     bDone = true;
@@ -130,6 +276,65 @@ int Task_Buffer::assign(const char *buffer, int length) {
   return count();
 }
 
+Task_ShellBuffer::~Task_ShellBuffer() {
+  // ...
+}
+
+bool Task_ShellBuffer::process_task(ShellStream& stream, int& afw) { // returns true on completion of task
+  if (afw && m_bufptr < m_bufend)
+    m_bufptr += stream.write_buffer(m_bufptr, m_bufend - m_bufptr, afw);
+
+  if (m_bufptr < m_bufend)
+    return false;
+
+  discard();
+  return true;
+}
+
+void Task_ShellBuffer::discard() {
+  if (m_buffer) {
+    m_buffer->return_to_owner();
+    m_buffer = 0;
+  }
+}
+
+Broadcast::~Broadcast() {
+  // ...
+}
+
+void Broadcast::release() {
+  if (--m_refs > 0)
+    return;
+
+  if (m_buffer) {
+    m_buffer->return_to_owner();
+    m_buffer = 0;
+  }
+  return_to_owner();
+}
+
+Task_Broadcast::~Task_Broadcast() {
+  // ...
+}
+
+bool Task_Broadcast::process_task(ShellStream& stream, int& afw) { // returns true on completion of task
+  if (afw && m_bufptr < m_bufend)
+    m_bufptr += stream.write_buffer(m_bufptr, m_bufend - m_bufptr, afw);
+
+  if (m_bufptr < m_bufend)
+    return false;
+
+  discard();
+  return true;
+}
+
+void Task_Broadcast::discard() {
+  if (m_payload) {
+    m_payload->release();
+    m_payload = 0;
+  }
+}
+
 Task_Printable::~Task_Printable() {
   // ...
 }
@@ -140,7 +345,6 @@ bool Task_Printable::process_task(ShellStream& stream, int& afw) { // returns tr
   bool bDone = false;
 
   int pcount = m_list->printable_count();
-  int icount = m_list->count();
 
   while (afw) {
     if (m_iindex < 0 && m_pindex < pcount) { // writing the list's description, etc., if any
@@ -162,28 +366,25 @@ bool Task_Printable::process_task(ShellStream& stream, int& afw) { // returns tr
 	m_ptr = 0;
 	continue;
       }
-      stream.write(*m_ptr++, afw);
+      m_ptr += stream.write(m_ptr, strlen(m_ptr), afw);
       continue;
     }
     
     if (!m_item) {                           // no pointer set; get next item
-      if (++m_iindex >= icount) {            // the list has no (or no further) items
+      if (m_inext == m_list->end()) {        // the list has no (or no further) items
 	bDone = true;
 	break;
       }
-      m_item = m_list->item(m_iindex);
-      if (!m_item) { // oops
-	bDone = true;
-	break;
-      }
-      pcount = m_item->printable_count();
+      m_item = &*m_inext;
+      ++m_inext;
+      ++m_iindex;
       m_pindex = -1;
       m_ptr = 0;
       continue;
     }
 
     if (!m_ptr) {                            // no pointer set; get next printable
-      if (++m_pindex >= pcount) {            // the item has no (or no further) printables
+      if (++m_pindex >= m_item->printable_count()) { // the item has no (or no further) printables
 	m_item = 0;
 	continue;
       }
@@ -205,7 +406,7 @@ bool Task_Printable::process_task(ShellStream& stream, int& afw) { // returns tr
       m_ptr = 0;
       continue;
     }
-    stream.write(*m_ptr++, afw);
+    m_ptr += stream.write(m_ptr, strlen(m_ptr), afw);
     continue;
   }
   return bDone;
@@ -215,72 +416,191 @@ Task_Comma::~Task_Comma() {
   // ...
 }
 
+int Task_Comma::encode(const CommaCommand& command, char *buffer, bool bBinary, CommaDelta *delta) {
+  unsigned long d;
+  if (delta && delta->encode(command, d)) // against the last value actually sent
+    return Comma::encode_delta(command.m_command, d, buffer, BytesMax, bBinary);
+  if (bBinary)
+    return Comma::encode_frame(&command, 1, buffer, BytesMax);
+  return Comma::encode_text(command, buffer, BytesMax);
+}
+
 bool Task_Comma::process_task(ShellStream& stream, int& afw) { // returns true on completion of task
-  bool bDone = false;
+  if (!m_bStarted) {
+    m_bStarted = true;
+    m_frame_length = encode(m_pending, m_frame, m_bBinary, m_delta);
+    m_frame_index = 0;
+  }
+  while (afw && m_frame_index < m_frame_length)
+    stream.write_byte(m_frame[m_frame_index++], afw);
+
+  if (m_frame_index < m_frame_length)
+    return false;
+
+  stream.set_boundary();
+  return true;
+}
 
+bool Task_Comma::coalesce(const CommaCommand& command, bool bBinary) {
+  if (command.m_command != m_pending.m_command || bBinary != m_bBinary)
+    return false;
+  if (m_bStarted)
+    return false;
+
+  m_pending = command;
+  return true;
+}
+
+Task_CommaBatch::~Task_CommaBatch() {
+  // ...
+}
+
+int Task_CommaBatch::assign(const CommaCommand *commands, int count, bool bBinary, CommaDelta *delta) {
+  if (count > Capacity)
+    count = Capacity;
+  for (int i = 0; i < count; i++)
+    m_commands[i] = commands[i];
+
+  m_delta   = delta;
+  m_bBinary = bBinary;
+  m_count   = count;
+  m_index   = 0;
+
+  m_frame_length = 0;
+  m_frame_index  = 0;
+
+  return count;
+}
+
+bool Task_CommaBatch::process_task(ShellStream& stream, int& afw) { // returns true on completion of task
   while (afw) {
-    if (m_command) {
-      stream.write(m_command, afw);
-      m_command = 0;
+    if (m_frame_index < m_frame_length) {
+      stream.write_byte(m_frame[m_frame_index++], afw);
+      if (m_frame_index == m_frame_length)
+	stream.set_boundary();
       continue;
     }
-    if (m_digits) {
-      unsigned long divisor = 1;
-      for (int i = 1; i < m_digits; i++)
-	divisor *= 10;
-      unsigned long digit = m_value / divisor;
-      m_value -= digit * divisor;
-      --m_digits;
-      stream.write('0' + digit, afw);
+    if (m_index == m_count)
+      break;
+
+    const CommaCommand& C = m_commands[m_index++];
+    CommaDelta *delta = (m_delta && m_delta->compact(C.m_command)) ? m_delta : 0;
+
+    m_frame_length = Task_Comma::encode(C, m_frame, m_bBinary, delta);
+    m_frame_index = 0;
+  }
+  return (m_index == m_count) && (m_frame_index == m_frame_length);
+}
+
+Task_CommaVector::~Task_CommaVector() {
+  // ...
+}
+
+void Task_CommaVector::next_value() { // text mode: the letter (first), the value, and the separator
+  CommaCommand C = m_vector[m_index];
+
+  int length = 0;
+  if (!m_index)
+    m_frame[length++] = m_vector.m_command;
+
+  char marker = C.marker();
+  if (marker)
+    m_frame[length++] = marker;
+
+  unsigned long value = C.magnitude();
+  if (value)
+    length += Comma::format_digits(value, m_frame + length);
+
+  m_frame[length++] = (++m_index < m_vector.count()) ? ':' : ',';
+
+  m_frame_length = length;
+  m_frame_index = 0;
+}
+
+bool Task_CommaVector::process_task(ShellStream& stream, int& afw) { // returns true on completion of task
+  while (afw) {
+    if (m_frame_index < m_frame_length) {
+      stream.write_byte(m_frame[m_frame_index++], afw);
       continue;
     }
-    stream.write(',', afw);
-    bDone = true;
-    break;
+    if (m_bBinary || m_index == m_vector.count())
+      break;
+    next_value();
   }
-  return bDone;
+  if ((m_frame_index < m_frame_length) || !(m_bBinary || m_index == m_vector.count()))
+    return false;
+
+  stream.set_boundary();
+  return true;
 }
 
 Repository::Repository() {
-  for (int i = 0; i < 4; i++) {
-    m_gpbuf[i].init(m_buf_gp[i], 128);
-    m_owner_gp.push(m_gpbuf[i], true);
+  for (int i = 0; i < rp_Count; i++) {
+    m_dropped[i] = 0;
   }
 
-  for (int i = 0; i < 16; i++) {
-    m_owner_os.push(m_ostrs[i], true);
+  for (int i = 0; i < C::TmpBuffers; i++) {
+    m_gpbuf[i].init(m_buf_gp[i], C::TmpBufSize);
+    m_owner_gp.adopt(m_gpbuf[i]);
   }
-  for (int i = 0; i < 2; i++) {
-    m_owner_pl.push(m_plist[i], true);
+
+  for (int i = 0; i < C::OffsetStrings; i++) {
+    m_owner_os.adopt(m_ostrs[i]);
   }
-  for (int i = 0; i < 16; i++) {
-    m_owner_cc.push(m_comma[i], true);
+  for (int i = 0; i < C::PrintableLists; i++) {
+    m_owner_pl.adopt(m_plist[i]);
   }
+  for (int i = 0; i < C::CommaTasks; i++) {
+    m_owner_cc.adopt(m_comma[i]);
+  }
+#if MULTISHELL_COMMA_VECTORS > 0
+  for (int i = 0; i < C::CommaVectors; i++) {
+    m_owner_cv.adopt(m_cvect[i]);
+  }
+#endif
+#if MULTISHELL_COMMA_BATCHES > 0
+  for (int i = 0; i < C::CommaBatches; i++) {
+    m_owner_cb.adopt(m_batch[i]);
+  }
+#endif
+#if MULTISHELL_OWNED_BUFFERS > 0
+  for (int i = 0; i < C::OwnedBuffers; i++) {
+    m_owner_sb.adopt(m_sbufs[i]);
+  }
+#endif
+#if MULTISHELL_BROADCASTS > 0 && MULTISHELL_BROADCAST_TASKS > 0
+  for (int i = 0; i < C::Broadcasts; i++) {
+    m_owner_bc.adopt(m_bcast[i]);
+  }
+  for (int i = 0; i < C::BroadcastTasks; i++) {
+    m_owner_bt.adopt(m_btask[i]);
+  }
+#endif
 
   Task_Buffer *tptr = m_tasks;
 
-  char *base = m_buf_16;
-  for (int i = 0; i < 16; i++) {
-    tptr->init(base, 16);
-    base += 16;
-    m_owner_16.push(*tptr++, true);
+  char *base = m_buf_small;
+  for (int i = 0; i < C::SmallBuffers; i++) {
+    tptr->init(base, C::SmallBufSize);
+    base += C::SmallBufSize;
+    m_owner_sm.adopt(*tptr++);
   }
-  base = m_buf_32;
-  for (int i = 0; i < 8; i++) {
-    tptr->init(base, 32);
-    base += 32;
-    m_owner_32.push(*tptr++, true);
+  base = m_buf_medium;
+  for (int i = 0; i < C::MediumBuffers; i++) {
+    tptr->init(base, C::MediumBufSize);
+    base += C::MediumBufSize;
+    m_owner_md.adopt(*tptr++);
   }
-  base = m_buf_64;
-  for (int i = 0; i < 4; i++) {
-    tptr->init(base, 64);
-    base += 64;
-    m_owner_64.push(*tptr++, true);
+  base = m_buf_large;
+  for (int i = 0; i < C::LargeBuffers; i++) {
+    tptr->init(base, C::LargeBufSize);
+    base += C::LargeBufSize;
+    m_owner_lg.adopt(*tptr++);
   }
 }
 
-static inline Task *s_buftask(TaskOwner<Task_Buffer>& owner, unsigned capacity, const char *& buffer, unsigned& length) {
-  Task_Buffer *tptr = owner.pop();
+static inline Task *s_buftask(ItemPool<Task_Buffer>& owner, unsigned capacity, const char *& buffer, unsigned& length) {
+  Task_Buffer *tptr = owner.try_pop(); // a larger buffer may do instead
   if (tptr) {
     int sublen = (length > capacity) ? capacity : length;
     tptr->assign(buffer, sublen);
@@ -291,39 +611,225 @@ static inline Task *s_buftask(TaskOwner<Task_Buffer>& owner, unsigned capacity,
 }
 
 bool Repository::dispatch_buffer(TaskOwner<Task>& manager, const char *buffer, unsigned length) {
-  while (length > 32) {
-    Task *tptr = s_buftask(m_owner_64, 64, buffer, length);
-    if (!tptr)
+  while (length > C::MediumBufSize) {
+    Task *tptr = s_buftask(m_owner_lg, C::LargeBufSize, buffer, length);
+    if (!tptr) // smaller buffers will do
       break;
     manager.push(*tptr);
   }
-  while (length > 16) {
-    Task *tptr = s_buftask(m_owner_32, 32, buffer, length);
-    if (!tptr)
-      tptr = s_buftask(m_owner_64, 64, buffer, length);
+  while (length > C::SmallBufSize) {
+    Task *tptr = s_buftask(m_owner_md, C::MediumBufSize, buffer, length);
     if (!tptr)
+      tptr = s_buftask(m_owner_lg, C::LargeBufSize, buffer, length);
+    if (!tptr) // small buffers will do
       break;
     manager.push(*tptr);
   }
   while (length) {
-    Task *tptr = s_buftask(m_owner_16, 16, buffer, length);
-    if (!tptr)
-      tptr = s_buftask(m_owner_32, 32, buffer, length);
+    Task *tptr = s_buftask(m_owner_sm, C::SmallBufSize, buffer, length);
     if (!tptr)
-      tptr = s_buftask(m_owner_64, 64, buffer, length);
+      tptr = s_buftask(m_owner_md, C::MediumBufSize, buffer, length);
     if (!tptr)
+      tptr = s_buftask(m_owner_lg, C::LargeBufSize, buffer, length);
+    if (!tptr) { // all buffers in use
+      m_owner_sm.count_failure();
       break;
+    }
     manager.push(*tptr);
   }
   return (length == 0);
 }
 
+bool Repository::dispatch_owned(TaskOwner<Task>& manager, ShellBuffer *buffer) {
+  if (!buffer)
+    return false;
+
+  Task_ShellBuffer *tptr = buffer->count() ? m_owner_sb.try_pop() : 0;
+  if (tptr) {
+    tptr->assign(*buffer);
+    manager.push(*tptr);
+    return true;
+  }
+  bool bOkay = !buffer->count() || dispatch_buffer(manager, *buffer); // copied instead
+  if (!bOkay && C::OwnedBuffers)
+    m_owner_sb.count_failure();
+  buffer->return_to_owner();
+  return bOkay;
+}
+
+bool Repository::dispatch_batch(TaskOwner<Task>& manager, const CommaCommand *commands, int count, bool bBinary, CommaDelta *delta) {
+  if (!C::CommaBatches) // compiled out
+    return false;
+
+  while (count > 0) {
+    Task_CommaBatch *tptr = m_owner_cb.pop();
+    if (!tptr)
+      return false;
+
+    int taken = tptr->assign(commands, count, bBinary, delta);
+    manager.push(*tptr);
+
+    commands += taken;
+    count -= taken;
+  }
+  return true;
+}
+
+int Repository::available(RepositoryPool pool) const {
+  switch (pool) {
+  case rp_OffsetString:
+    return m_owner_os.count();
+  case rp_Printable:
+    return m_owner_pl.count();
+  case rp_Comma:
+    return m_owner_cc.count();
+  case rp_CommaVector:
+    return m_owner_cv.count();
+  case rp_CommaBatch:
+    return m_owner_cb.count();
+  case rp_Buffer:
+    return m_owner_sm.count() * C::SmallBufSize + m_owner_md.count() * C::MediumBufSize + m_owner_lg.count() * C::LargeBufSize;
+  case rp_Owned:
+    return m_owner_sb.count();
+  case rp_Broadcast:
+    return m_owner_bc.count() ? m_owner_bt.count() : 0; // a payload is needed too
+  case rp_TmpBuffer:
+    return m_owner_gp.count();
+  default:
+    break;
+  }
+  return 0;
+}
+
+int Repository::capacity(RepositoryPool pool) const {
+  switch (pool) {
+  case rp_OffsetString:
+    return m_owner_os.capacity();
+  case rp_Printable:
+    return m_owner_pl.capacity();
+  case rp_Comma:
+    return m_owner_cc.capacity();
+  case rp_CommaVector:
+    return m_owner_cv.capacity();
+  case rp_CommaBatch:
+    return m_owner_cb.capacity();
+  case rp_Buffer:
+    return C::SmallBuffers * C::SmallBufSize + C::MediumBuffers * C::MediumBufSize + C::LargeBuffers * C::LargeBufSize;
+  case rp_Owned:
+    return m_owner_sb.capacity();
+  case rp_Broadcast:
+    return m_owner_bc.capacity() ? m_owner_bt.capacity() : 0;
+  case rp_TmpBuffer:
+    return m_owner_gp.capacity();
+  default:
+    break;
+  }
+  return 0;
+}
+
+template<class T> static inline void s_status(ShellBuffer& buffer, const char *name, const ItemPool<T>& pool) {
+  buffer << name << pool.count() << '/' << pool.capacity();
+}
+
+template<class T> static inline void s_usage(ShellBuffer& buffer, const char *name, const ItemPool<T>& pool) {
+  buffer << name << pool.peak() << '/' << pool.failed();
+}
+
 void Repository::status(ShellBuffer& buffer) {
-  buffer.printf("Free currently, OffStr: %2d/16; List: %d/2; CC: %d/16; Buf-16: %2d/16; Buf-32: %d/8; Buf-64: %d/4",
-		m_owner_os.count(), m_owner_pl.count(), m_owner_cc.count(),
-		m_owner_16.count(), m_owner_32.count(), m_owner_64.count());
+  buffer << "Free:";
+  s_status(buffer, " OffStr ", m_owner_os);
+  s_status(buffer, ", List ",  m_owner_pl);
+  s_status(buffer, ", CC ",    m_owner_cc);
+  s_status(buffer, ", CV ",    m_owner_cv);
+  s_status(buffer, ", CB ",    m_owner_cb);
+  s_status(buffer, ", Buf ",   m_owner_sm); // small, medium & large
+  s_status(buffer, " ",        m_owner_md);
+  s_status(buffer, " ",        m_owner_lg);
+  s_status(buffer, ", SB ",    m_owner_sb);
+  s_status(buffer, ", BC ",    m_owner_bc); // payloads & tasks
+  s_status(buffer, " ",        m_owner_bt);
+  s_status(buffer, ", Tmp ",   m_owner_gp);
+}
+
+void Repository::usage(ShellBuffer& buffer) {
+  buffer << "Peak/failed:";
+  s_usage(buffer, " OffStr ", m_owner_os);
+  s_usage(buffer, ", List ",  m_owner_pl);
+  s_usage(buffer, ", CC ",    m_owner_cc);
+  s_usage(buffer, ", CV ",    m_owner_cv);
+  s_usage(buffer, ", CB ",    m_owner_cb);
+  s_usage(buffer, ", Buf ",   m_owner_sm);
+  s_usage(buffer, " ",        m_owner_md);
+  s_usage(buffer, " ",        m_owner_lg);
+  s_usage(buffer, ", SB ",    m_owner_sb);
+  s_usage(buffer, ", BC ",    m_owner_bc);
+  s_usage(buffer, " ",        m_owner_bt);
+  s_usage(buffer, ", Tmp ",   m_owner_gp);
+}
+
+void Repository::reset_usage() {
+  m_owner_gp.reset_usage();
+  m_owner_os.reset_usage();
+  m_owner_pl.reset_usage();
+  m_owner_cc.reset_usage();
+  m_owner_cv.reset_usage();
+  m_owner_cb.reset_usage();
+  m_owner_sm.reset_usage();
+  m_owner_md.reset_usage();
+  m_owner_lg.reset_usage();
+  m_owner_sb.reset_usage();
+  m_owner_bc.reset_usage();
+  m_owner_bt.reset_usage();
 }
 
 Dispatcher::~Dispatcher() {
   // ...
 }
+
+int Dispatcher::broadcast(Dispatcher *const *targets, int count, ShellBuffer *buffer) {
+  Repository *repository = 0;
+  for (int i = 0; i < count && !repository; i++)
+    if (targets[i])
+      repository = targets[i]->m_repository;
+
+  if (!repository) {
+    if (buffer)
+      buffer->return_to_owner();
+    return 0;
+  }
+
+  bool bEmpty = !buffer || !buffer->count();
+
+  Broadcast *payload = repository->broadcast_payload(buffer);
+  if (!payload) {
+    if (!bEmpty)
+      for (int i = 0; i < count; i++)
+	if (targets[i])
+	  targets[i]->accepted(false, rp_Broadcast);
+    return 0;
+  }
+
+  int reached = 0;
+  for (int i = 0; i < count; i++)
+    if (targets[i] && targets[i]->accepted(repository->dispatch_broadcast(*targets[i]->m_manager, *payload), rp_Broadcast))
+      ++reached;
+
+  payload->release(); // if no target was reached, the buffer is returned now
+  return reached;
+}
+
+bool Dispatcher::check_capacity() {
+  if (!m_waiting)
+    return true;
+
+  for (int pool = 0; pool < rp_Count; pool++)
+    if ((m_waiting & (1U << pool)) && m_repository->available((RepositoryPool) pool))
+      m_waiting &= ~(1U << pool);
+
+  if (m_waiting)
+    return false;
+
+  if (m_waiter)
+    m_waiter->capacity_returned(*this);
+  return true;
+}
@@ -23,14 +23,22 @@ namespace MultiShell {
     static const unsigned char fMaskRSVP = 0x70;
 
     unsigned char  m_flags;
+    unsigned long  m_deadline; // millis() after which the task is discarded unsent, or 0 for none
   public:
-    Task() : m_flags(0)
+    Task() : m_flags(0), m_deadline(0)
     {
       // ...
     }
     virtual ~Task();
 
     virtual bool process_task(ShellStream& stream, int& afw); // returns true on completion of task
+
+    /* The task is dropped unfinished, e.g., expired or flushed on disconnect, and process_task() won't be
+     * called again; a task that holds a resource (a buffer, a payload, an open file) must release it here
+     */
+    virtual void discard();
+
+    virtual bool coalesce(const CommaCommand& command, bool bBinary); // returns true if command replaces this task's value
   private:
     inline void push_eol() {
       unsigned char eol_count = m_flags & fMaskEOL;
@@ -41,38 +49,164 @@ namespace MultiShell {
     }
   };
 
+  enum TaskLane {
+    tl_Bulk = 0, // default; e.g., command responses, listings, plots
+    tl_Control   // written ahead of bulk output, at the next line (or frame) boundary
+  };
+
+  enum DisconnectPolicy { // what happens to queued output while the stream is disconnected
+    dp_KeepAll = 0, // default; it is sent on reconnection
+    dp_KeepControl, // bulk output is discarded
+    dp_FlushAll     // all output is discarded
+  };
+
+  /* The list itself is the bulk lane; a second, control lane takes priority, but output only switches
+   * lanes at a line (or frame) boundary, or when the other lane has nothing (more) to write.
+   */
   class TaskList : public LinkedList {
   private:
-    unsigned char  m_flags;
+    ItemOwner<Task> m_control;
+    unsigned char  m_flags;         // bulk lane EOL & RSVP
+    unsigned char  m_control_flags; // control lane EOL & RSVP
+    TaskLane       m_lane;          // lane for new tasks
+    bool           m_bControl;      // control lane wrote last
+    unsigned short m_ack_wait;      // control tasks to be sent before the bulk lane's ACK
+    int            m_budget;        // maximum bytes per process_tasks(), or 0 for no limit
+    bool           m_bCoalesce;
+    unsigned long  m_coalesced;
+    unsigned long  m_ttl;           // time to live (ms) of new tasks, or 0 for no limit
+    unsigned long  m_discarded;
+    DisconnectPolicy m_policy;
   public:
-    TaskList() : m_flags(0) {
+    TaskList() :
+      m_flags(0),
+      m_control_flags(0),
+      m_lane(tl_Bulk),
+      m_bControl(false),
+      m_ack_wait(0),
+      m_budget(0),
+      m_bCoalesce(false),
+      m_coalesced(0),
+      m_ttl(0),
+      m_discarded(0),
+      m_policy(dp_KeepAll)
+    {
       // ...
     }
     virtual ~TaskList();
   protected:
     virtual void linked_item_push(LinkedItem& item);
+  private:
+    static inline void s_push_eol(unsigned char& flags) {
+      unsigned char eol_count = flags & Task::fMaskEOL;
+      if (eol_count < 3) {
+	flags &= ~Task::fMaskEOL;
+	flags |= ++eol_count;
+      }
+    }
+    int process_lane(ShellStream& stream, int& afw, Task *current, unsigned char& flags, unsigned long now, bool bHoldACK);
+
+    inline void pop_control() {
+      m_control.pop_and_return();
+      if (m_ack_wait)
+	--m_ack_wait;
+    }
+
+    void set_deadline(Task& task); // now + time to live, if any
   public:
+    inline int count() const { // tasks in both lanes
+      return LinkedList::count() + m_control.count();
+    }
+    inline void pop_and_return() {
+      if (m_control.count())
+	pop_control();
+      else
+	LinkedList::pop_and_return();
+    }
+
+    inline void set_lane(TaskLane lane) { // lane for subsequent tasks, EOLs
+      m_lane = lane;
+    }
+    inline TaskLane lane() const {
+      return m_lane;
+    }
+
     inline void push_eol() {
-      Task *tptr = (Task *) linked_item(count()-1);
-      if (tptr) {
+      Task *tptr = (m_lane == tl_Control) ? m_control.last() : (Task *) linked_item_last();
+      if (tptr)
 	tptr->push_eol();
-      } else {
-	unsigned char eol_count = m_flags & Task::fMaskEOL;
-	if (eol_count < 3) {
-	  m_flags &= ~Task::fMaskEOL;
-	  m_flags |= ++eol_count;
-	}
-      }
+      else
+	s_push_eol((m_lane == tl_Control) ? m_control_flags : m_flags);
     }
+    /* The ACK follows everything queued before it, in either lane: it goes at the end of the bulk lane, if
+     * that has anything queued, and waits there for the control tasks queued before it
+     */
     inline void respond_to_RSVP() {
-      Task *tptr = (Task *) linked_item(count()-1);
-      if (tptr) {
+      Task *tptr = (Task *) linked_item_last();
+      if (tptr || m_flags) {
+	if (tptr)
+	  tptr->m_flags |= Task::fMaskRSVP;
+	else
+	  m_flags |= Task::fMaskRSVP;
+	m_ack_wait = m_control.count();
+      } else if ((tptr = m_control.last())) {
         tptr->m_flags |= Task::fMaskRSVP;
       } else {
-        m_flags |= Task::fMaskRSVP;
+        m_control_flags |= Task::fMaskRSVP;
       }
     }
+    /* process_tasks() writes as many tasks as the stream has room for, but no more than the budget,
+     * if set, so that one busy shell doesn't hold up the rest of the loop
+     */
+    inline void set_write_budget(int bytes) { // 0 for no limit; otherwise at least BudgetMin
+      m_budget = (bytes <= 0) ? 0 : ((bytes < BudgetMin) ? BudgetMin : bytes);
+    }
+    inline int write_budget() const {
+      return m_budget;
+    }
+    static const int BudgetMin = 8; // enough for any EOL
+
     void process_tasks(ShellStream& stream);
+
+    /* Coalescing: a new CommaCommand overwrites the value of a queued command with the same letter in the
+     * same lane, if that hasn't started sending yet, so that at most one value per letter is waiting; the
+     * value keeps its place in the queue, and its time to live starts again.
+     */
+    inline void set_coalescing(bool bCoalesce) {
+      m_bCoalesce = bCoalesce;
+    }
+    inline bool coalescing() const {
+      return m_bCoalesce;
+    }
+    inline unsigned long coalesced() const { // number of values overwritten
+      return m_coalesced;
+    }
+    bool coalesce(const CommaCommand& command, bool bBinary);
+
+    /* Stale output: a task not (fully) written within its time to live is discarded at the next line (or
+     * frame) boundary, and, depending on the policy, queued output is discarded while disconnected
+     */
+    inline void set_time_to_live(unsigned long ms) { // for subsequent tasks; 0 for no limit
+      m_ttl = ms;
+    }
+    inline unsigned long time_to_live() const {
+      return m_ttl;
+    }
+    inline void set_disconnect_policy(DisconnectPolicy policy) {
+      m_policy = policy;
+    }
+    inline DisconnectPolicy disconnect_policy() const {
+      return m_policy;
+    }
+    inline unsigned long discarded() const { // number of tasks expired or flushed
+      return m_discarded;
+    }
+    void flush(bool bControl = true); // discards queued bulk output, and control output too if bControl
+
+    inline void disconnected() { // applies the disconnect policy
+      if (m_policy != dp_KeepAll)
+	flush(m_policy == dp_FlushAll);
+    }
   };
 
   template<class T> class TaskOwner : public TaskList {
@@ -87,9 +221,18 @@ namespace MultiShell {
     inline T *pop() {
       return (T *) linked_item_pop();
     }
-    inline const T *item(int index) const {
+    inline const T *item(int index) const { // O(index); prefer iteration
       return (const T *) linked_item(index);
     }
+
+    typedef LinkedIterator<T>       iterator;
+    typedef LinkedIterator<const T> const_iterator;
+
+    inline iterator begin() { return iterator((T *) linked_item_next(0)); }
+    inline iterator end()   { return iterator(0); }
+
+    inline const_iterator begin() const { return const_iterator((const T *) linked_item_next(0)); }
+    inline const_iterator end()   const { return const_iterator(0); }
   };
 
   class Task_OffsetString : public Task {
@@ -138,10 +281,88 @@ namespace MultiShell {
     virtual bool process_task(ShellStream& stream, int& afw); // returns true on completion of task
   };
 
+  /* Streams directly from a ShellBuffer, without copying, and then returns the buffer to its owner
+   */
+  class Task_ShellBuffer : public Task {
+  private:
+    ShellBuffer *m_buffer;
+    const char  *m_bufptr;
+    const char  *m_bufend;
+  public:
+    Task_ShellBuffer() : m_buffer(0), m_bufptr(0), m_bufend(0) {
+      // ...
+    }
+    virtual ~Task_ShellBuffer();
+
+    inline void assign(ShellBuffer& buffer) {
+      m_buffer = &buffer;
+      m_bufptr = buffer.buffer();
+      m_bufend = m_bufptr + buffer.count();
+    }
+
+    virtual bool process_task(ShellStream& stream, int& afw); // returns true on completion of task
+
+    virtual void discard(); // returns the buffer to its owner
+  };
+
+  /* A payload shared by the Task_Broadcasts of several shells; the ShellBuffer, and the Broadcast itself,
+   * are returned to their owners when the last task has finished writing it
+   */
+  class Broadcast : public LinkedItem {
+  private:
+    ShellBuffer *m_buffer;
+    int          m_refs;
+  public:
+    Broadcast() : m_buffer(0), m_refs(0) {
+      // ...
+    }
+    virtual ~Broadcast();
+
+    inline void assign(ShellBuffer& buffer) {
+      m_buffer = &buffer;
+      m_refs = 1; // held by the dispatcher until release()
+    }
+    inline void retain() {
+      ++m_refs;
+    }
+    void release();
+
+    inline const char *buffer() const {
+      return m_buffer->buffer();
+    }
+    inline int count() const {
+      return m_buffer->count();
+    }
+  };
+
+  class Task_Broadcast : public Task {
+  private:
+    Broadcast   *m_payload;
+    const char  *m_bufptr;
+    const char  *m_bufend;
+  public:
+    Task_Broadcast() : m_payload(0), m_bufptr(0), m_bufend(0) {
+      // ...
+    }
+    virtual ~Task_Broadcast();
+
+    inline void assign(Broadcast& payload) {
+      payload.retain();
+      m_payload = &payload;
+      m_bufptr = payload.buffer();
+      m_bufend = m_bufptr + payload.count();
+    }
+
+    virtual bool process_task(ShellStream& stream, int& afw); // returns true on completion of task
+
+    virtual void discard(); // releases the payload
+  };
+
   class Task_Printable : public Task {
   private:
     const PrintableList *m_list;
     const PrintableItem *m_item;
+    PrintableList::const_iterator m_inext; // the item after m_item
     const char  *m_ptr;
     int  m_offset;
     int  m_iindex;
@@ -150,6 +371,7 @@ namespace MultiShell {
     Task_Printable() :
       m_list(0),
       m_item(0),
+      m_inext(0),
       m_ptr(0),
       m_offset(0),
       m_iindex(-1),
@@ -162,6 +384,7 @@ namespace MultiShell {
     inline void assign(const PrintableList& list) {
       m_list = &list;
       m_item = 0;
+      m_inext = list.begin();
       m_ptr = 0;
       m_iindex = -1;
       m_pindex = -1;
@@ -171,63 +394,194 @@ namespace MultiShell {
   };
 
   class Task_Comma : public Task {
+  public:
+    static const int BytesMax = (Comma::TextSingle > Comma::FrameSingle) ? Comma::TextSingle : Comma::FrameSingle; // >= DeltaText
+
+    /* Encode a command as text, a binary frame, or (if delta is not null) a compact delta
+     */
+    static int encode(const CommaCommand& command, char *buffer, bool bBinary, CommaDelta *delta);
   private:
-    unsigned long  m_value;
-    char     m_command;
-    uint8_t  m_digits;
+    CommaCommand   m_pending; // the command to send; encoded when sending starts
+    CommaDelta    *m_delta;   // compact state, if the letter is sent compactly
+    bool     m_bBinary;
+    bool     m_bStarted;
+    uint8_t  m_frame_length;
+    uint8_t  m_frame_index;
+    char     m_frame[BytesMax];
   public:
     Task_Comma() :
-      m_value(0),
-      m_command(0),
-      m_digits(0)
+      m_delta(0),
+      m_bBinary(false),
+      m_bStarted(false),
+      m_frame_length(0),
+      m_frame_index(0)
     {
       // ...
     }
     virtual ~Task_Comma();
 
-    inline void assign(const CommaCommand& C) {
-      m_value   = C.m_value;
-      m_command = C.m_command;
-      m_digits  = 0;
-
-      if (m_value) {
-	m_digits = 1;
-	unsigned long divisor = 1;
-	while (true) {
-	  if (m_value / divisor < 10)
-	    break;
-	  ++m_digits;
-	  divisor *= 10;
-	}
-      }
+    inline void assign(const CommaCommand& C, bool bBinary = false, CommaDelta *delta = 0) {
+      m_pending  = C;
+      m_delta    = delta;
+      m_bBinary  = bBinary;
+      m_bStarted = false;
     }
 
     virtual bool process_task(ShellStream& stream, int& afw); // returns true on completion of task
+
+    virtual bool coalesce(const CommaCommand& command, bool bBinary);
   };
 
-  class Repository {
+  /* Several commands in one pooled task, e.g., a burst of telemetry; each is encoded in turn when
+   * reached, and sent exactly as if dispatched separately (but never coalesced)
+   */
+  class Task_CommaBatch : public Task {
+  public:
+    static const int Capacity = 8;
   private:
-    char m_buf_gp[4][128];
+    CommaCommand   m_commands[Capacity];
+    CommaDelta    *m_delta;  // compact state, if any
+    bool     m_bBinary;
+    uint8_t  m_count;
+    uint8_t  m_index;        // the next command to encode
+    uint8_t  m_frame_length;
+    uint8_t  m_frame_index;
+    char     m_frame[Task_Comma::BytesMax];
+  public:
+    Task_CommaBatch() :
+      m_delta(0),
+      m_bBinary(false),
+      m_count(0),
+      m_index(0),
+      m_frame_length(0),
+      m_frame_index(0)
+    {
+      // ...
+    }
+    virtual ~Task_CommaBatch();
 
-    char m_buf_16[256];
-    char m_buf_32[256];
-    char m_buf_64[256];
+    int assign(const CommaCommand *commands, int count, bool bBinary = false, CommaDelta *delta = 0); // returns number taken
 
-    ShellBuffer       m_gpbuf[4];
+    virtual bool process_task(ShellStream& stream, int& afw); // returns true on completion of task
+  };
 
-    Task_Buffer       m_tasks[28];
-    Task_OffsetString m_ostrs[16];
-    Task_Printable    m_plist[2];
-    Task_Comma        m_comma[16];
+  class Task_CommaVector : public Task {
+  private:
+    CommaVector    m_vector;
+    bool     m_bBinary;
+    uint8_t  m_index;        // text mode: the next value to encode
+    uint8_t  m_frame_length; // binary frame, or text for the current value
+    uint8_t  m_frame_index;
+    char     m_frame[Comma::FrameMax];
+
+    void next_value();
+  public:
+    Task_CommaVector() :
+      m_bBinary(false),
+      m_index(0),
+      m_frame_length(0),
+      m_frame_index(0)
+    {
+      // ...
+    }
+    virtual ~Task_CommaVector();
+
+    inline bool assign(const CommaVector& V, bool bBinary = false) { // false if too large for a binary frame
+      m_vector  = V;
+      m_bBinary = bBinary;
+      m_index   = 0;
+
+      m_frame_length = 0;
+      m_frame_index  = 0;
 
-    ItemOwner<ShellBuffer>       m_owner_gp; // general purpose buffers
+      if (bBinary)
+	m_frame_length = Comma::encode_frame(V, m_frame, Comma::FrameMax);
 
-    TaskOwner<Task_OffsetString> m_owner_os; // offset strings
-    TaskOwner<Task_Printable>    m_owner_pl; // printable lists
-    TaskOwner<Task_Comma>        m_owner_cc; // comma commands
-    TaskOwner<Task_Buffer>       m_owner_16; // buffers of size 16
-    TaskOwner<Task_Buffer>       m_owner_32; // buffers of size 32
-    TaskOwner<Task_Buffer>       m_owner_64; // buffers of size 64
+      return !bBinary || m_frame_length;
+    }
+
+    virtual bool process_task(ShellStream& stream, int& afw); // returns true on completion of task
+  };
+
+  /* Pool sizes of the Repository; see ShellConfig.hh
+   */
+  struct RepositoryConfig {
+    static const int TmpBuffers      = MULTISHELL_TMP_BUFFERS;
+    static const int TmpBufSize      = MULTISHELL_TMP_BUFSIZE;
+    static const int OffsetStrings   = MULTISHELL_OFFSET_STRINGS;
+    static const int PrintableLists  = MULTISHELL_PRINTABLE_LISTS;
+    static const int CommaTasks      = MULTISHELL_COMMA_TASKS;
+    static const int CommaVectors    = MULTISHELL_COMMA_VECTORS;
+    static const int CommaBatches    = MULTISHELL_COMMA_BATCHES;
+    static const int OwnedBuffers    = MULTISHELL_OWNED_BUFFERS;
+    static const int Broadcasts      = MULTISHELL_BROADCASTS;
+    static const int BroadcastTasks  = MULTISHELL_BROADCAST_TASKS;
+    static const int SmallBuffers    = MULTISHELL_SMALL_BUFFERS;
+    static const int SmallBufSize    = MULTISHELL_SMALL_BUFSIZE;
+    static const int MediumBuffers   = MULTISHELL_MEDIUM_BUFFERS;
+    static const int MediumBufSize   = MULTISHELL_MEDIUM_BUFSIZE;
+    static const int LargeBuffers    = MULTISHELL_LARGE_BUFFERS;
+    static const int LargeBufSize    = MULTISHELL_LARGE_BUFSIZE;
+  };
+
+  enum RepositoryPool { // for capacity queries, and counting drops
+    rp_OffsetString = 0,
+    rp_Printable,
+    rp_Comma,
+    rp_CommaVector,
+    rp_CommaBatch,
+    rp_Buffer,       // buffer tasks; capacity is in bytes
+    rp_Owned,
+    rp_Broadcast,    // broadcast tasks (one per shell)
+    rp_TmpBuffer,
+    rp_Count
+  };
+
+  class Repository {
+  private:
+    typedef RepositoryConfig C;
+
+    char m_buf_gp[C::TmpBuffers][C::TmpBufSize];
+
+    char m_buf_small[C::SmallBuffers * C::SmallBufSize];
+    char m_buf_medium[C::MediumBuffers * C::MediumBufSize];
+    char m_buf_large[C::LargeBuffers * C::LargeBufSize];
+
+    ShellBuffer       m_gpbuf[C::TmpBuffers];
+
+    Task_Buffer       m_tasks[C::SmallBuffers + C::MediumBuffers + C::LargeBuffers];
+#if MULTISHELL_OWNED_BUFFERS > 0
+    Task_ShellBuffer  m_sbufs[C::OwnedBuffers];
+#endif
+#if MULTISHELL_BROADCASTS > 0 && MULTISHELL_BROADCAST_TASKS > 0
+    Broadcast         m_bcast[C::Broadcasts];
+    Task_Broadcast    m_btask[C::BroadcastTasks];
+#endif
+    Task_OffsetString m_ostrs[C::OffsetStrings];
+    Task_Printable    m_plist[C::PrintableLists];
+    Task_Comma        m_comma[C::CommaTasks];
+#if MULTISHELL_COMMA_VECTORS > 0
+    Task_CommaVector  m_cvect[C::CommaVectors];
+#endif
+#if MULTISHELL_COMMA_BATCHES > 0
+    Task_CommaBatch   m_batch[C::CommaBatches];
+#endif
+
+    ItemPool<ShellBuffer>       m_owner_gp; // general purpose buffers
+
+    ItemPool<Task_OffsetString> m_owner_os; // offset strings
+    ItemPool<Task_Printable>    m_owner_pl; // printable lists
+    ItemPool<Task_Comma>        m_owner_cc; // comma commands
+    ItemPool<Task_CommaVector>  m_owner_cv; // comma vectors
+    ItemPool<Task_CommaBatch>   m_owner_cb; // comma batches
+    ItemPool<Task_Buffer>       m_owner_sm; // small buffers
+    ItemPool<Task_Buffer>       m_owner_md; // medium buffers
+    ItemPool<Task_Buffer>       m_owner_lg; // large buffers
+    ItemPool<Task_ShellBuffer>  m_owner_sb; // owned ShellBuffers
+    ItemPool<Broadcast>         m_owner_bc; // broadcast payloads
+    ItemPool<Task_Broadcast>    m_owner_bt; // broadcast tasks
+
+    unsigned long m_dropped[rp_Count];
   public:
     Repository();
 
@@ -235,7 +589,7 @@ namespace MultiShell {
       // ...
     }
 
-    /** returns pointer to a 128-byte buffer for temporary use; use B->return_to_owner() to free
+    /** returns pointer to a buffer (of size RepositoryConfig::TmpBufSize) for temporary use; use B->return_to_owner() to free
      */
     inline ShellBuffer *tmp_buffer() {
       ShellBuffer *B = m_owner_gp.pop();
@@ -263,11 +617,41 @@ namespace MultiShell {
     inline bool dispatch_buffer(TaskOwner<Task>& manager, const ShellBuffer& buffer) {
       return dispatch_buffer(manager, buffer.buffer(), (unsigned) buffer.count());
     }
-    inline bool dispatch_command(TaskOwner<Task>& manager, const CommaCommand& command) {
+    /* Takes ownership of buffer: streams from it (or, if no task is free, copies it) and then returns it
+     * to its owner, e.g., the pool of tmp_buffer()s
+     */
+    bool dispatch_owned(TaskOwner<Task>& manager, ShellBuffer *buffer);
+
+    /* Broadcasting: take a payload for the buffer (which is returned to its owner if there are none free),
+     * dispatch it to each manager in turn, then release() it
+     */
+    inline Broadcast *broadcast_payload(ShellBuffer *buffer) {
+      if (!buffer)
+	return 0;
+      Broadcast *payload = (buffer->count() && C::Broadcasts && C::BroadcastTasks) ? m_owner_bc.pop() : 0;
+      if (payload)
+	payload->assign(*buffer);
+      else
+	buffer->return_to_owner();
+      return payload;
+    }
+    inline bool dispatch_broadcast(TaskOwner<Task>& manager, Broadcast& payload) {
+      if (!C::Broadcasts || !C::BroadcastTasks) // compiled out
+	return false;
+      Task_Broadcast *tptr = m_owner_bt.pop();
+      if (tptr) {
+	tptr->assign(payload);
+	manager.push(*tptr);
+	return true;
+      }
+      return false;
+    }
+
+    inline bool dispatch_command(TaskOwner<Task>& manager, const CommaCommand& command, bool bBinary = false, CommaDelta *delta = 0) {
       if (command.m_command) {
 	Task_Comma *tptr = m_owner_cc.pop();
 	if (tptr) {
-	  tptr->assign(command);
+	  tptr->assign(command, bBinary, delta);
 	  manager.push(*tptr);
 	  return true;
 	}
@@ -275,6 +659,23 @@ namespace MultiShell {
       return false;
     }
 
+    inline bool dispatch_vector(TaskOwner<Task>& manager, const CommaVector& vector, bool bBinary = false) {
+      if (vector.m_command && vector.count() && C::CommaVectors) {
+	Task_CommaVector *tptr = m_owner_cv.pop();
+	if (tptr) {
+	  if (!tptr->assign(vector, bBinary)) { // large values may not fit in a binary frame; not split, as the receiver
+	    tptr->return_to_owner();          // expects the vector whole - it's dropped, and counted by the Dispatcher
+	    return false;
+	  }
+	  manager.push(*tptr);
+	  return true;
+	}
+      }
+      return false;
+    }
+
+    bool dispatch_batch(TaskOwner<Task>& manager, const CommaCommand *commands, int count, bool bBinary = false, CommaDelta *delta = 0);
+
     inline bool dispatch_printable_list(TaskOwner<Task>& manager, const PrintableList& list) {
       Task_Printable *tptr = m_owner_pl.pop();
       if (tptr) {
@@ -285,24 +686,73 @@ namespace MultiShell {
       return false;
     }
 
-    void status(ShellBuffer& buffer);
+    int available(RepositoryPool pool) const; // items free (bytes, for rp_Buffer)
+    int capacity(RepositoryPool pool) const;  // items in all (bytes, for rp_Buffer)
+
+    inline bool exhausted(RepositoryPool pool) const { // nothing free in a pool that isn't compiled out
+      return !available(pool) && capacity(pool);
+    }
+
+    inline void count_drop(RepositoryPool pool) { // a dispatch failed for want of the pool
+      ++m_dropped[pool];
+    }
+    inline unsigned long dropped(RepositoryPool pool) const {
+      return m_dropped[pool];
+    }
+
+    void status(ShellBuffer& buffer); // free/capacity of each pool
+    void usage(ShellBuffer& buffer);  // peak usage and failed allocations of each pool
+    void reset_usage();
   };
 
   class Dispatcher {
+  public:
+    class Waiter {
+    public:
+      virtual void capacity_returned(Dispatcher& dispatcher) = 0; // the pools that ran dry have items free again
+
+      virtual ~Waiter() { }
+    };
   private:
     TaskOwner<Task> *m_manager;
     Repository      *m_repository;
+    CommaDelta      *m_compact;
+    Waiter          *m_waiter;
+    unsigned long    m_dropped;
+    unsigned         m_waiting; // bit-mask of RepositoryPools that have run dry since the last notification
+    bool             m_bBinary;
+
+    inline bool accepted(bool bAccepted, RepositoryPool pool) {
+      if (!bAccepted) {
+	++m_dropped;
+	if (m_repository->exhausted(pool)) { // not if rejected, e.g., too large, or the pool is compiled out
+	  m_waiting |= 1U << pool;
+	  m_repository->count_drop(pool);
+	}
+      }
+      return bAccepted;
+    }
   public:
     Dispatcher(TaskOwner<Task>& manager, Repository& repository) :
       m_manager(&manager),
-      m_repository(&repository)
+      m_repository(&repository),
+      m_compact(0),
+      m_waiter(0),
+      m_dropped(0),
+      m_waiting(0),
+      m_bBinary(false)
     {
       // ...
     }
   protected:
     Dispatcher() :
       m_manager(0),
-      m_repository(0)
+      m_repository(0),
+      m_compact(0),
+      m_waiter(0),
+      m_dropped(0),
+      m_waiting(0),
+      m_bBinary(false)
     {
       // ...
     }
@@ -310,26 +760,112 @@ namespace MultiShell {
       m_manager = &manager;
       m_repository = &repository;
     }
+    inline void set_binary_mode(bool bBinary) { // send CommaCommands as binary frames
+      m_bBinary = bBinary;
+    }
   public:
     virtual ~Dispatcher();
 
+    inline bool binary_mode() const {
+      return m_bBinary;
+    }
+
+    inline void set_lane(TaskLane lane) { // e.g., tl_Control for telemetry to preempt bulk output
+      m_manager->set_lane(lane);
+    }
+    inline TaskLane lane() const {
+      return m_manager->lane();
+    }
+
+    inline void set_write_budget(int bytes) { // maximum bytes written per update, or 0 for no limit
+      m_manager->set_write_budget(bytes);
+    }
+
+    inline void set_time_to_live(unsigned long ms) { // subsequent output is discarded if not sent in time
+      m_manager->set_time_to_live(ms);
+    }
+    inline void set_disconnect_policy(DisconnectPolicy policy) { // e.g., dp_KeepControl
+      m_manager->set_disconnect_policy(policy);
+    }
+    inline unsigned long discarded() const {
+      return m_manager->discarded();
+    }
+
+    inline void set_coalescing(bool bCoalesce) { // last-value-wins for queued CommaCommands
+      m_manager->set_coalescing(bCoalesce);
+    }
+    inline unsigned long coalesced() const {
+      return m_manager->coalesced();
+    }
+
+    /* Backpressure: check available() before composing output; if a dispatch fails anyway, it is counted
+     * as dropped, and waiting() is true until check_capacity() finds the pools have items free again, when
+     * the waiter, if any, is notified (Shell::update() checks every time)
+     */
+    inline int available(RepositoryPool pool) const {
+      return m_repository->available(pool);
+    }
+    inline unsigned long dropped() const {
+      return m_dropped;
+    }
+    inline bool waiting() const {
+      return m_waiting;
+    }
+    inline void set_waiter(Waiter *waiter) {
+      m_waiter = waiter;
+    }
+    bool check_capacity(); // returns true if not (or no longer) waiting
+
+    inline void set_compact_state(CommaDelta *state) { // letters enabled in state are sent as deltas
+      m_compact = state;
+    }
+    inline void resync() { // send the next value for each letter in full
+      if (m_compact)
+	m_compact->resync();
+    }
+
     inline bool dispatch_offset_string(const char *str, unsigned offset = 0) {
-      return m_repository->dispatch_offset_string(*m_manager, str, offset);
+      return accepted(m_repository->dispatch_offset_string(*m_manager, str, offset), rp_OffsetString);
     }
     inline bool dispatch_buffer(const char *buffer, unsigned length) {
       if (buffer && length)
 	if (*buffer)
-	  return m_repository->dispatch_buffer(*m_manager, buffer, length);
+	  return accepted(m_repository->dispatch_buffer(*m_manager, buffer, length), rp_Buffer);
       return false;
     }
     inline bool dispatch_buffer(const ShellBuffer& buffer) {
-      return m_repository->dispatch_buffer(*m_manager, buffer);
+      return accepted(m_repository->dispatch_buffer(*m_manager, buffer), rp_Buffer);
+    }
+    inline bool dispatch_owned(ShellBuffer *buffer) { // buffer must not be used after this call
+      if (!buffer)
+	return false;
+      return accepted(m_repository->dispatch_owned(*m_manager, buffer), rp_Buffer); // fallback is to copy
     }
+
+    /* Sends one copy of the buffer to each of the targets, which must share a repository; as with
+     * dispatch_owned(), the buffer must not be used after this call; returns the number of targets reached
+     */
+    static int broadcast(Dispatcher *const *targets, int count, ShellBuffer *buffer);
+
     inline bool dispatch_command(const CommaCommand& command) {
-      return m_repository->dispatch_command(*m_manager, command);
+      if (!command.m_command)
+	return false;
+      if (m_manager->coalescing())
+	if (m_manager->coalesce(command, m_bBinary))
+	  return true;
+      CommaDelta *delta = (m_compact && m_compact->compact(command.m_command)) ? m_compact : 0;
+      return accepted(m_repository->dispatch_command(*m_manager, command, m_bBinary, delta), rp_Comma);
+    }
+    inline bool dispatch_vector(const CommaVector& vector) {
+      if (!vector.m_command || !vector.count())
+	return false;
+      return accepted(m_repository->dispatch_vector(*m_manager, vector, m_bBinary), rp_CommaVector);
+    }
+    inline bool dispatch_batch(const CommaCommand *commands, int count) { // several commands in as few tasks as possible
+      return accepted(m_repository->dispatch_batch(*m_manager, commands, count, m_bBinary, m_compact), rp_CommaBatch);
     }
     inline bool dispatch_printable_list(const PrintableList& list) {
-      return m_repository->dispatch_printable_list(*m_manager, list);
+      return accepted(m_repository->dispatch_printable_list(*m_manager, list), rp_Printable);
     }
     inline void add_task(Task& task) {
       return m_manager->push(task);
@@ -347,6 +883,10 @@ namespace MultiShell {
     lhs.dispatch_command(command);
     return lhs;
   }
+  inline Dispatcher& operator<<(Dispatcher& lhs, const CommaVector& vector) {
+    lhs.dispatch_vector(vector);
+    return lhs;
+  }
   inline Dispatcher& operator<<(Dispatcher& lhs, const PrintableList& list) {
     lhs.dispatch_printable_list(list);
     return lhs;
@@ -18,14 +18,12 @@ LinkedList::~LinkedList() {
 }
 
 void LinkedList::linked_item_push(LinkedItem& item) {
-  if (!m_next) {
+  if (!m_next)
     m_next = &item;
-  } else {
-    LinkedItem *iptr = m_next;
-    while (iptr->m_next)
-      iptr = iptr->m_next;
-    iptr->m_next = &item;
-  }
+  else
+    m_last->m_next = &item;
+  m_last = &item;
+
   item.m_next = 0;
   ++m_count;
 }
@@ -34,6 +32,8 @@ LinkedItem *LinkedList::linked_item_pop() {
   LinkedItem *iptr = m_next;
   if (iptr) {
     m_next = iptr->m_next;
+    if (!m_next)
+      m_last = 0;
     iptr->m_next = 0;
     --m_count;
   }
@@ -43,6 +43,9 @@ LinkedItem *LinkedList::linked_item_pop() {
 LinkedItem *LinkedList::linked_item(int index) const {
   LinkedItem *iptr = m_next;
 
+  if (index == m_count - 1)
+    return m_last;
+
   if (index >= 0 && index < m_count) {
     while (index--)
       iptr = iptr->m_next;
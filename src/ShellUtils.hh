@@ -30,6 +30,8 @@
 #include <unistd.h>
 #endif
 
+#include <ShellConfig.hh>
+
 namespace MultiShell {
 
 #ifdef OS_Linux
@@ -41,7 +43,8 @@ namespace MultiShell {
      ce_Okay = 0,
      ce_IncorrectUsage,
      ce_UnhandledCommand,
-     ce_OtherError
+     ce_OtherError,
+     ce_Pending // not yet finished; see ShellHandler::resume_command()
     };
   enum InputState
     {
@@ -49,12 +52,15 @@ namespace MultiShell {
      is_Start,
      is_Discard,
      is_Processing,
-     is_String
+     is_String,
+     is_Binary  // binary CommaComms input processing
     };
 
   class LinkedItem;
   class LinkedList;
 
+  template<class T> class LinkedIterator;
+
   class LinkedItemOwner {
     friend LinkedItem;
   protected:
@@ -66,6 +72,7 @@ namespace MultiShell {
 
   class LinkedItem {
     friend LinkedList;
+    template<class T> friend class LinkedIterator;
   private:
     LinkedItem      *m_next;
     LinkedItemOwner *m_owner;
@@ -84,12 +91,41 @@ namespace MultiShell {
     }
   };
 
+  /* Forward iterator over the items of a LinkedList, e.g., for (const Command& C : list) ...
+   */
+  template<class T> class LinkedIterator {
+  private:
+    T *m_item;
+  public:
+    LinkedIterator(T *item) : m_item(item) {
+      // ...
+    }
+
+    inline T& operator*() const {
+      return *m_item;
+    }
+    inline T *operator->() const {
+      return m_item;
+    }
+    inline LinkedIterator& operator++() {
+      m_item = (T *) m_item->m_next;
+      return *this;
+    }
+    inline bool operator==(const LinkedIterator& rhs) const {
+      return m_item == rhs.m_item;
+    }
+    inline bool operator!=(const LinkedIterator& rhs) const {
+      return m_item != rhs.m_item;
+    }
+  };
+
   class LinkedList : public LinkedItemOwner {
   private:
     LinkedItem *m_next;
+    LinkedItem *m_last; // tail, for O(1) push
     int         m_count;
   public:
-    LinkedList() : m_next(0), m_count(0) {
+    LinkedList() : m_next(0), m_last(0), m_count(0) {
       // ...
     }
     virtual ~LinkedList();
@@ -100,6 +136,13 @@ namespace MultiShell {
     virtual void linked_item_push(LinkedItem& item);
     virtual LinkedItem *linked_item_pop();
     LinkedItem *linked_item(int index) const;
+
+    inline LinkedItem *linked_item_next(const LinkedItem *item) const { // first item if item is null
+      return item ? item->m_next : m_next;
+    }
+    inline LinkedItem *linked_item_last() const {
+      return m_last;
+    }
   public:
     inline int count() const {
       return m_count;
@@ -123,9 +166,72 @@ namespace MultiShell {
     inline T *pop() {
       return (T *) linked_item_pop();
     }
-    inline const T *item(int index) const {
+    inline const T *item(int index) const { // O(index); prefer iteration
       return (const T *) linked_item(index);
     }
+    inline T *first() const {
+      return (T *) linked_item_next(0);
+    }
+    inline T *last() const {
+      return (T *) linked_item_last();
+    }
+
+    typedef LinkedIterator<T>       iterator;
+    typedef LinkedIterator<const T> const_iterator;
+
+    inline iterator begin() { return iterator((T *) linked_item_next(0)); }
+    inline iterator end()   { return iterator(0); }
+
+    inline const_iterator begin() const { return const_iterator((const T *) linked_item_next(0)); }
+    inline const_iterator end()   const { return const_iterator(0); }
+  };
+
+  /* An ItemOwner used as a fixed-size pool, which keeps count of peak usage and failed allocations
+   */
+  template<class T> class ItemPool : public ItemOwner<T> {
+  private:
+    int           m_capacity;
+    int           m_peak;
+    unsigned long m_failed;
+  public:
+    ItemPool() : m_capacity(0), m_peak(0), m_failed(0) {
+      // ...
+    }
+    virtual ~ItemPool() { }
+
+    inline void adopt(T& item) { // add a new item to the pool
+      ItemOwner<T>::push(item, true);
+      ++m_capacity;
+    }
+    inline T *pop() {
+      T *item = try_pop();
+      if (!item)
+	++m_failed;
+      return item;
+    }
+    inline T *try_pop() { // for a caller with a fallback; an empty pool isn't counted unless count_failure()
+      T *item = ItemOwner<T>::pop();
+      if (item && m_peak < m_capacity - this->count())
+	m_peak = m_capacity - this->count();
+      return item;
+    }
+    inline void count_failure() { // the pool, and any fallback, were empty
+      ++m_failed;
+    }
+
+    inline int capacity() const {
+      return m_capacity;
+    }
+    inline int peak() const { // most items in use at any one time
+      return m_peak;
+    }
+    inline unsigned long failed() const { // number of times the pool was empty, with no fallback
+      return m_failed;
+    }
+    inline void reset_usage() {
+      m_peak = m_capacity - this->count();
+      m_failed = 0;
+    }
   };
 
   class PrintableItem : public LinkedItem {
@@ -278,7 +384,7 @@ namespace MultiShell {
 	    if (length && extra) {                       // we can read more...
 	      extra = (extra > length) ? length : extra; // or length, if less
 
-	      memcpy(ptr, data_start, extra);
+	      memcpy(ptr + count, data_start, extra);
 	      data_start += extra;
 
 	      count += extra;
@@ -325,7 +431,7 @@ namespace MultiShell {
 	      if (length && extra) {                       // we can write more...
 		extra = (extra > length) ? length : extra; // or length, if less
 
-		memcpy(data_end, ptr, extra);
+		memcpy(data_end, ptr + count, extra);
 		data_end += extra;
 
 		count += extra;
@@ -438,11 +544,17 @@ namespace MultiShell {
       char c;
       if (!m_in.pop(c))
 	return -1;
-      return c;
+      return (unsigned char) c; // like Serial.read(), 0-255
+    }
+    inline int read(char *ptr, int length) { // returns number of bytes read
+      return m_in.read(ptr, length);
     }
     inline bool write(char c) {
       return m_out.push(c);
     }
+    inline int write(const char *ptr, int length) { // returns number of bytes written
+      return m_out.write(ptr, length);
+    }
   };
 
 } // MultiShell